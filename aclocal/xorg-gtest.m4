@@ -43,7 +43,7 @@ AC_DEFUN([CHECK_XORG_GTEST],
   XORG_GTEST_CPPFLAGS="$GTEST_CPPFLAGS $XORG_GTEST_CPPFLAGS"
   XORG_GTEST_CPPFLAGS="$XORG_GTEST_CPPFLAGS -I$XORG_GTEST_SOURCE"
 
-  PKG_CHECK_MODULES(X11, [x11], [have_x11=yes], [have_x11=no])
+  PKG_CHECK_MODULES(X11, [x11 xi xres], [have_x11=yes], [have_x11=no])
 
   # Check if we should include support for evemu
   AC_ARG_WITH([evemu],
@@ -100,6 +100,22 @@ TEST_F(ServerTest, DisplayHeight) {
   ASSERT_GT(DisplayHeight(Display(), 0), 0);
 }
 
+/**
+ * The same fixture without the boilerplate: xorg::testing::Test starts
+ * a server per test itself if asked to. Use SCOPE_PER_SUITE instead to
+ * share one server between all tests of the fixture.
+ */
+class ScopedServerTest : public Test {
+public:
+  ScopedServerTest() {
+    SetServerScope(SCOPE_PER_TEST);
+  }
+};
+
+TEST_F(ScopedServerTest, DisplayWidth) {
+  ASSERT_GT(DisplayWidth(Display(), 0), 0);
+}
+
 int main(int argc, char **argv) {
   ::testing::InitGoogleTest(&argc, argv);
   return RUN_ALL_TESTS();
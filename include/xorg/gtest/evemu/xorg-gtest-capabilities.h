@@ -0,0 +1,162 @@
+/*******************************************************************************
+ *
+ * X testing environment - snapshot of evemu device capabilities
+ *
+ * Copyright © 2026 xorg-gtest contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ ******************************************************************************/
+
+
+#ifndef XORG_GTEST_EVEMU_CAPABILITIES_H_
+#define XORG_GTEST_EVEMU_CAPABILITIES_H_
+
+#include <bitset>
+#include <ostream>
+#include <vector>
+
+#include <xorg/gtest/evemu/xorg-gtest-device.h>
+
+namespace xorg {
+namespace testing {
+namespace evemu {
+
+/**
+ * @class DeviceCapabilities xorg-gtest-capabilities.h xorg/gtest/evemu/xorg-gtest-capabilities.h
+ *
+ * Snapshot of the events and absolute axes a device supports.
+ *
+ * The snapshot queries the device once. Afterwards, lookups are bit
+ * tests, and capabilities of several devices can be combined and compared
+ * as sets of (type, code) pairs. Types are the event types, e.g. EV_KEY,
+ * the EV_SYN bits are the supported event types.
+ *
+ * @code
+ * DeviceCapabilities common = DeviceCapabilities(mouse) & DeviceCapabilities(touchpad);
+ * for (int code = common.NextCode(EV_KEY, -1); code != -1;
+ *      code = common.NextCode(EV_KEY, code))
+ *   ...
+ * @endcode
+ */
+class DeviceCapabilities {
+ public:
+  /**
+   * Create an empty set of capabilities.
+   */
+  DeviceCapabilities();
+
+  /**
+   * Take a snapshot of the capabilities of a device, as its device node
+   * reports them: one EVIOCGBIT per event type and one EVIOCGABS per
+   * absolute axis.
+   *
+   * @throws std::runtime_error if the device node cannot be opened or
+   *         an axis cannot be queried.
+   */
+  explicit DeviceCapabilities(Device &device);
+
+  /**
+   * Take the capabilities of a compile-time descriptor.
+   */
+  explicit DeviceCapabilities(const DeviceDescriptor &descriptor);
+
+  /**
+   * Add an event, and its type to the supported types.
+   */
+  void SetEvent(int type, int code);
+
+  /**
+   * Add an absolute axis with its data.
+   */
+  void SetAbsData(int code, int min, int max, int fuzz = 0, int flat = 0,
+                  int resolution = 0);
+
+  /**
+   * @return true if this event is supported.
+   */
+  bool HasEvent(int type, int code) const;
+
+  /**
+   * Retrieve data about an absolute axis, see Device::GetAbsData().
+   *
+   * @return false if the axis is not supported, or true on success
+   */
+  bool GetAbsData(int code, int *min, int *max, int *fuzz = NULL,
+                  int *flat = NULL, int *resolution = NULL) const;
+
+  /**
+   * @return The codes supported for an event type.
+   */
+  const std::bitset<KEY_CNT>& GetCodes(int type) const;
+
+  /**
+   * Iterate over the supported codes of an event type.
+   *
+   * @param [in] type The event type.
+   * @param [in] code The previous code, -1 to start.
+   *
+   * @return The next supported code after code, or -1 if there is none.
+   */
+  int NextCode(int type, int code) const;
+
+  /**
+   * @return The number of supported codes of an event type.
+   */
+  unsigned int Count(int type) const;
+
+  /**
+   * @return The events supported by both. Axis data is taken from this
+   *         snapshot.
+   */
+  DeviceCapabilities operator&(const DeviceCapabilities &other) const;
+
+  /**
+   * @return The events supported by either. Axis data is taken from this
+   *         snapshot where both support an axis.
+   */
+  DeviceCapabilities operator|(const DeviceCapabilities &other) const;
+
+  /**
+   * @return The events supported by this snapshot but not the other.
+   */
+  DeviceCapabilities operator-(const DeviceCapabilities &other) const;
+
+  /**
+   * Compare the supported events and the data of all supported axes.
+   */
+  bool operator==(const DeviceCapabilities &other) const;
+  bool operator!=(const DeviceCapabilities &other) const;
+
+ private:
+  std::bitset<KEY_CNT> bits_[EV_CNT];
+  struct input_absinfo abs_[ABS_CNT];
+};
+
+/**
+ * Prints the supported codes of each supported type, and the axis data.
+ */
+std::ostream& operator<<(std::ostream &os, const DeviceCapabilities &caps);
+
+} // namespace evemu
+} // namespace testing
+} // namespace xorg
+
+#endif // XORG_GTEST_EVEMU_CAPABILITIES_H_
@@ -31,6 +31,9 @@
 
 #include <memory>
 #include <string>
+#include <vector>
+
+#include <stdint.h>
 
 extern "C" {
 
@@ -38,10 +41,106 @@ extern "C" {
 
 } // extern "C"
 
+/**
+ * Compile-time assertion, e.g. on a generated descriptor:
+ * XORG_GTEST_STATIC_ASSERT((descriptors::SynPS2_Synaptics_TouchPad::Has<EV_ABS, ABS_MT_SLOT>::value), touchpad_is_mt);
+ */
+#define XORG_GTEST_STATIC_ASSERT(cond, name) \
+  typedef char xorg_gtest_static_assert_##name[(cond) ? 1 : -1] \
+    __attribute__((unused))
+
 namespace xorg {
 namespace testing {
 namespace evemu {
 
+/**
+ * An absolute axis of a DeviceDescriptor.
+ */
+struct AbsAxisDescriptor {
+  int code;
+  int minimum;
+  int maximum;
+  int fuzz;
+  int flat;
+  int resolution;
+};
+
+/**
+ * A bitmask of a DeviceDescriptor, bit n of byte n / 8 is code n.
+ */
+struct BitsDescriptor {
+  const unsigned char *bits;
+  unsigned int size;
+};
+
+/**
+ * A device description known at compile time.
+ *
+ * Descriptors are generated from evemu device property files by
+ * evemu-desc-to-header.awk, shipped with the xorg-gtest sources. A
+ * Device created from a descriptor is set up through uinput directly,
+ * without reading or parsing a file.
+ */
+struct DeviceDescriptor {
+  const char *name;
+  unsigned short bustype;
+  unsigned short vendor;
+  unsigned short product;
+  unsigned short version;
+  BitsDescriptor props;
+  BitsDescriptor events[EV_CNT];  /**< events[0] are the event types */
+  const AbsAxisDescriptor *axes;
+  unsigned int naxes;
+
+  /**
+   * @return true if the device supports this event.
+   */
+  bool HasEvent(int type, int code) const;
+
+  /**
+   * @return The axis with this code or NULL.
+   */
+  const AbsAxisDescriptor* GetAbsAxis(int code) const;
+};
+
+/**
+ * @class DeviceDescription xorg-gtest-device.h xorg/gtest/evemu/xorg-gtest-device.h
+ *
+ * The contents of an evemu device property file, held in memory.
+ *
+ * Descriptions read from a file are cached for the whole process, keyed by
+ * the path and the modification time of the file, so creating the same
+ * device many times reads its file once. Devices parse a description into
+ * a DeviceDescriptor the first time it is used and reuse that afterwards.
+ */
+class DeviceDescription {
+ public:
+  /**
+   * Create a description from an in-memory evemu device property file.
+   *
+   * @param [in] text The contents of an evemu device property file.
+   */
+  explicit DeviceDescription(const std::string& text);
+
+  /**
+   * Return the description stored in a file, from the cache if the file
+   * did not change since it was last read.
+   *
+   * @param [in] path Path to evemu device property file.
+   *
+   * @throws std::runtime_error if the file could not be read.
+   */
+  static DeviceDescription FromFile(const std::string& path);
+
+  /**
+   * @return The contents of the evemu device property file.
+   */
+  const std::string& GetText() const;
+
+ private:
+  std::string text_;
+};
+
 /**
  * @class Device xorg-gtest-device.h xorg/gtest/evemu/xorg-gtest-device.h
  *
@@ -53,6 +152,26 @@ namespace evemu {
 
 class Device {
  public:
+  /**
+   * Timing of a recording's playback.
+   */
+  enum PlaybackMode {
+    PLAYBACK_REALTIME,  /**< Frames are played at their recorded times */
+    PLAYBACK_SCALED,    /**< Recorded delays are divided by a speed factor */
+    PLAYBACK_FAST,      /**< Frames are played back to back */
+  };
+
+  /**
+   * Timing of the last playback, see GetPlaybackStats().
+   */
+  struct PlaybackStats {
+    unsigned int frames;    /**< Number of frames played */
+    double target_ms;       /**< Duration the playback mode asked for */
+    double actual_ms;       /**< Duration the playback took */
+    double mean_jitter_us;  /**< Mean delay of frames behind their time */
+    double max_jitter_us;   /**< Largest delay of a frame behind its time */
+  };
+
   /**
    * Create a new device context.
    *
@@ -62,8 +181,46 @@ class Device {
    *         or the device could not be created.
    */
   explicit Device(const std::string& path);
+
+  /**
+   * Create a new device context from an in-memory description.
+   *
+   * @param [in] description The evemu device description.
+   *
+   * @throws std::runtime_error if the description could not be parsed or
+   *         the device could not be created.
+   */
+  explicit Device(const DeviceDescription& description);
+
+  /**
+   * Create a new device context from a compile-time descriptor.
+   *
+   * @param [in] descriptor The device descriptor. It must outlive the
+   *             device, generated descriptors are static.
+   *
+   * @throws std::runtime_error if the device could not be created.
+   */
+  explicit Device(const DeviceDescriptor& descriptor);
   ~Device();
 
+  /**
+   * Create several devices at once.
+   *
+   * The uinput devices are created concurrently and their device nodes
+   * are waited for together, through a single inotify watch, with one
+   * deadline for all of them. This function returns once all device nodes
+   * exist.
+   *
+   * @param [in] descriptions The evemu device descriptions.
+   *
+   * @return The devices, in the order of the descriptions. The caller owns
+   *         the devices and must delete them.
+   *
+   * @throws std::runtime_error if any of the devices could not be created.
+   *         No devices are left over in that case.
+   */
+  static std::vector<Device*> CreateMany(const std::vector<DeviceDescription>& descriptions);
+
   /**
    * Play a evemu recording through the device.
    *
@@ -76,6 +233,90 @@ class Device {
    */
   void Play(const std::string& path) const;
 
+  /**
+   * Play a evemu recording through the device with the given timing.
+   *
+   * Plays the recording through its compiled form, see PlayCompiled().
+   *
+   * @param [in] path Path to evemu recording file.
+   * @param [in] mode Timing of the playback.
+   * @param [in] factor Speed factor for PLAYBACK_SCALED, e.g. 10 to play
+   *             ten times faster than recorded. Ignored for other modes.
+   *
+   * @throws std::runtime_error if playback failed for any reason.
+   */
+  void Play(const std::string& path, PlaybackMode mode,
+            double factor = 1.0) const;
+
+  /**
+   * Compile an evemu recording into the binary format played by
+   * PlayCompiled().
+   *
+   * Compiled recordings are cached in the directory given by the
+   * XORG_GTEST_RECORDING_CACHE environment variable, or in xorg-gtest in
+   * $XDG_CACHE_HOME or ~/.cache, under the hash of the recording's
+   * contents. A recording is only parsed again if it changed. Cached
+   * files not owned by the user, writable by others or with a broken
+   * frame index are compiled again.
+   *
+   * @param [in] path Path to evemu recording file.
+   *
+   * @return The path to the compiled recording.
+   *
+   * @throws std::runtime_error if the recording could not be read or the
+   *         compiled recording could not be written.
+   */
+  static std::string CompileRecording(const std::string& path);
+
+  /**
+   * Play a evemu recording through the device from its compiled form.
+   *
+   * Like Play(), but the recording is compiled with CompileRecording()
+   * first, mapped into memory and each frame is written with a single
+   * write. This call will block until the recording has finished.
+   *
+   * In PLAYBACK_REALTIME and PLAYBACK_SCALED mode, frames are paced with a
+   * timerfd against their (scaled) recorded time since the first frame.
+   * The deviation from that time is available from GetPlaybackStats()
+   * afterwards.
+   *
+   * @param [in] path Path to evemu recording file.
+   * @param [in] mode Timing of the playback.
+   * @param [in] factor Speed factor for PLAYBACK_SCALED, e.g. 10 to play
+   *             ten times faster than recorded. Ignored for other modes.
+   *
+   * @throws std::runtime_error if playback failed for any reason.
+   */
+  void PlayCompiled(const std::string& path,
+                    PlaybackMode mode = PLAYBACK_REALTIME,
+                    double factor = 1.0) const;
+
+  /**
+   * Play frames of events through the device, one write per frame.
+   *
+   * Frames are timed by the time field of their first event, relative to
+   * the first frame.
+   *
+   * @param [in] events The events of all frames.
+   * @param [in] offsets The index of the first event of each frame,
+   *             followed by the total number of events.
+   * @param [in] nframes The number of frames, offsets has nframes + 1
+   *             entries.
+   * @param [in] mode Timing of the playback.
+   * @param [in] factor Speed factor for PLAYBACK_SCALED.
+   *
+   * @throws std::runtime_error if playback failed for any reason.
+   */
+  void PlayFrames(const struct input_event *events, const uint32_t *offsets,
+                  uint32_t nframes, PlaybackMode mode = PLAYBACK_FAST,
+                  double factor = 1.0) const;
+
+  /**
+   * Return the timing of the last Play() with a playback mode,
+   * PlayCompiled() or PlayFrames() call.
+   */
+  PlaybackStats GetPlaybackStats() const;
+
   /**
    * Play a single event through the device.
    *
@@ -90,13 +331,41 @@ class Device {
    */
   void PlayOne(int type, int code, int value, bool sync = false);
 
+  /**
+   * Queue an event for the next Flush().
+   *
+   * Queued events are kept in a buffer owned by the device that keeps its
+   * size across flushes, so queueing and flushing in a loop does not
+   * allocate once the buffer fits the largest batch.
+   *
+   * @param [in] type Evdev interface event type, e.g. EV_ABS, EV_REL, EV_KEY.
+   * @param [in] code Evdev interface event code, e.g. ABS_X, REL_Y, BTN_LEFT
+   * @param [in] value Event value
+   */
+  void QueueEvent(int type, int code, int value);
+
+  /**
+   * Terminate the current frame by queueing an EV_SYN SYN_REPORT event.
+   */
+  void EndFrame();
+
+  /**
+   * Submit all queued events, any number of frames, with a single write.
+   *
+   * @throws std::runtime_error if the events could not be written. The
+   *         queue is empty afterwards in either case.
+   */
+  void Flush();
+
   /**
    * Return the /dev/input/eventX device node for this device.
    *
-   * Note that evemu doesn't know the device node, so we traverse the file
-   * system looking for it. There is a tiny chance of the device node being
-   * wrong, or the device disappearing before we find it. If the device
-   * node cannot be found, an empty string is returned.
+   * The device node is looked up through the uinput device where the
+   * kernel supports UI_GET_SYSNAME (Linux 3.15 and later). On older
+   * kernels, we traverse the file system looking for it. There is a tiny
+   * chance of the device node being wrong, or the device disappearing
+   * before we find it. If the device node cannot be found, an empty string
+   * is returned.
    *
    * @return The string representing the device node
    */
@@ -135,7 +404,12 @@ class Device {
   Device(const Device&);
   Device& operator=(const Device&);
 
+  Device(const DeviceDescription& description, bool wait_for_node);
+  static void* CreateThread(void *data);
+
   void GuessDeviceNode(time_t ctime);
+  void Create(const DeviceDescription& description);
+  void CreateUinputDevice();
 };
 
 } // namespace evemu
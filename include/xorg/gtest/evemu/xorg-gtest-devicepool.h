@@ -0,0 +1,135 @@
+/*******************************************************************************
+ *
+ * X testing environment - pool of reusable evemu devices
+ *
+ * Copyright © 2026 xorg-gtest contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ ******************************************************************************/
+
+
+#ifndef XORG_GTEST_EVEMU_DEVICEPOOL_H_
+#define XORG_GTEST_EVEMU_DEVICEPOOL_H_
+
+#include <ctime>
+#include <memory>
+#include <string>
+
+#include <X11/Xlib.h>
+
+#include <xorg/gtest/evemu/xorg-gtest-device.h>
+
+namespace xorg {
+namespace testing {
+namespace evemu {
+
+/**
+ * @class DeviceLease xorg-gtest-devicepool.h xorg/gtest/evemu/xorg-gtest-devicepool.h
+ *
+ * A device borrowed from the process-wide DevicePool.
+ *
+ * Creating a uinput device and waiting for the X server to add it takes
+ * much longer than most tests using it, and removing it again makes the
+ * server send a hierarchy change to every client. A lease takes an idle
+ * device created from the same description from the pool instead, or
+ * creates one if all are in use. The device goes back to the pool when
+ * the lease is destroyed.
+ *
+ * Devices taken from the pool are reset: all keys and buttons are
+ * released, all touches ended and all absolute axes, including the
+ * multitouch axes of every slot, moved to their minimum. A test that
+ * needs another start position has to send it first.
+ *
+ * @code
+ * DeviceLease lease(TEST_ROOT_DIR "PIXART-USB-OPTICAL-MOUSE.desc");
+ * int deviceid = lease.GetXDeviceId(Display());
+ * lease.GetDevice().PlayOne(EV_REL, REL_X, 10, true);
+ * @endcode
+ */
+class DeviceLease {
+ public:
+  /**
+   * Lease a device created from an evemu device property file.
+   *
+   * @param [in] path Path to evemu device property file.
+   *
+   * @throws std::runtime_error if a new device could not be created.
+   */
+  explicit DeviceLease(const std::string &path);
+
+  /**
+   * Return the device to the pool.
+   */
+  ~DeviceLease();
+
+  /**
+   * @return The leased device.
+   */
+  Device& GetDevice();
+
+  /**
+   * Return the id of the X input device for the leased device. The id is
+   * looked up by the device node once and remembered by the pool, later
+   * leases of the same device only check that it is still valid.
+   *
+   * @param [in] display Display connection to the server.
+   * @param [in] timeout Time in ms to wait for the server to add the device.
+   *
+   * @return The device id, or -1 if the server did not add the device in
+   *         time.
+   */
+  int GetXDeviceId(::Display *display, time_t timeout = 1000);
+
+ private:
+  struct Private;
+  std::auto_ptr<Private> d_;
+
+  /* Disable copy constructor & assignment operator */
+  DeviceLease(const DeviceLease&);
+  DeviceLease& operator=(const DeviceLease&);
+};
+
+/**
+ * @class DevicePool xorg-gtest-devicepool.h xorg/gtest/evemu/xorg-gtest-devicepool.h
+ *
+ * The process-wide pool of devices handed out by DeviceLease.
+ */
+class DevicePool {
+ public:
+  /**
+   * @return The number of devices in the pool, leased or idle.
+   */
+  static unsigned int GetSize();
+
+  /**
+   * Destroy all idle devices in the pool.
+   */
+  static void Clear();
+
+ private:
+  DevicePool();
+};
+
+} // namespace evemu
+} // namespace testing
+} // namespace xorg
+
+#endif // XORG_GTEST_EVEMU_DEVICEPOOL_H_
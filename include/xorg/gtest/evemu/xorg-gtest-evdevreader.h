@@ -0,0 +1,172 @@
+/*******************************************************************************
+ *
+ * X testing environment - readback of injected evdev events
+ *
+ * Copyright © 2026 xorg-gtest contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ ******************************************************************************/
+
+
+#ifndef XORG_GTEST_EVEMU_EVDEVREADER_H_
+#define XORG_GTEST_EVEMU_EVDEVREADER_H_
+
+#include <ctime>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <linux/input.h>
+
+#include <xorg/gtest/evemu/xorg-gtest-device.h>
+
+namespace xorg {
+namespace testing {
+namespace evemu {
+
+/**
+ * @class EvdevReader xorg-gtest-evdevreader.h xorg/gtest/evemu/xorg-gtest-evdevreader.h
+ *
+ * Reads the events injected through a Device back from its event node.
+ *
+ * The event node is opened without grabbing it, so the X server still
+ * receives all events. Events injected through the reader are remembered
+ * with the time they were written, and Verify() checks that the kernel
+ * delivered the same sequence. This tells apart events lost between
+ * uinput and evdev from events lost in the server.
+ *
+ * The kernel drops events that do not change the device state, e.g. a
+ * key press of a key already down, an axis value equal to the last one or
+ * an empty frame. Such events show up as missing.
+ *
+ * @code
+ * EvdevReader reader(device);
+ * reader.Inject(EV_KEY, BTN_LEFT, 1, true);
+ * std::string mismatch;
+ * ASSERT_TRUE(reader.Verify(&mismatch)) << mismatch;
+ * @endcode
+ */
+class EvdevReader {
+ public:
+  /**
+   * Latency between writing events to uinput and the kernel timestamp of
+   * the events on the event node.
+   */
+  struct LatencyStats {
+    unsigned int events;  /**< Number of events measured */
+    double mean_us;       /**< Mean latency */
+    double max_us;        /**< Largest latency */
+  };
+
+  /**
+   * Open the event node of a device.
+   *
+   * @param [in] device The device, must outlive the reader.
+   *
+   * @throws std::runtime_error if the device node is unknown or could not
+   *         be opened.
+   */
+  explicit EvdevReader(Device& device);
+  ~EvdevReader();
+
+  /**
+   * Inject a single event through the device and remember it.
+   *
+   * @param [in] type Evdev interface event type, e.g. EV_ABS, EV_REL, EV_KEY.
+   * @param [in] code Evdev interface event code, e.g. ABS_X, REL_Y, BTN_LEFT
+   * @param [in] value Event value
+   * @param [in] sync If true, submit an EV_SYN event after this event
+   *
+   * @throws std::runtime_error if the event could not be written.
+   */
+  void Inject(int type, int code, int value, bool sync = false);
+
+  /**
+   * Inject events through the device with a single write and remember
+   * them. The time fields of the events are ignored.
+   *
+   * The events are written through Device::QueueEvent() and
+   * Device::Flush(), events already queued on the device are written
+   * first. The playback stats of the device are left alone.
+   *
+   * @param [in] events The events to inject.
+   * @param [in] count The number of events.
+   *
+   * @throws std::runtime_error if the events could not be written.
+   */
+  void Inject(const struct input_event *events, size_t count);
+
+  /**
+   * Read events from the event node until count events were read since
+   * the last Clear().
+   *
+   * @param [in] count The number of events to wait for.
+   * @param [in] timeout The timeout in milliseconds.
+   *
+   * @return Whether count events were read in time.
+   */
+  bool ReadEvents(size_t count, time_t timeout = 1000);
+
+  /**
+   * @return The events read since the last Clear(), with their kernel
+   *         timestamps.
+   */
+  const std::vector<struct input_event>& GetEvents() const;
+
+  /**
+   * Compare the events read from the event node with the injected ones.
+   *
+   * Waits for as many events as were injected, then compares their type,
+   * code and value in order. The latency of the matched events is
+   * available from GetLatencyStats() afterwards.
+   *
+   * @param [out] mismatch Description of the first difference, if any.
+   * @param [in] timeout The timeout in milliseconds to wait for events.
+   *
+   * @return true if the kernel delivered exactly the injected events.
+   */
+  bool Verify(std::string *mismatch = NULL, time_t timeout = 1000);
+
+  /**
+   * Return the latency of the events compared by the last Verify().
+   */
+  LatencyStats GetLatencyStats() const;
+
+  /**
+   * Forget all injected and read events and discard any events pending
+   * on the event node.
+   */
+  void Clear();
+
+ private:
+  struct Private;
+  std::auto_ptr<Private> d_;
+
+  /* Disable copy constructor & assignment operator */
+  EvdevReader(const EvdevReader&);
+  EvdevReader& operator=(const EvdevReader&);
+};
+
+} // namespace evemu
+} // namespace testing
+} // namespace xorg
+
+#endif // XORG_GTEST_EVEMU_EVDEVREADER_H_
@@ -0,0 +1,227 @@
+/*******************************************************************************
+ *
+ * X testing environment - multitouch gesture synthesis
+ *
+ * Copyright © 2026 xorg-gtest contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ ******************************************************************************/
+
+
+#ifndef XORG_GTEST_EVEMU_GESTURE_H_
+#define XORG_GTEST_EVEMU_GESTURE_H_
+
+#include <memory>
+
+#include <xorg/gtest/evemu/xorg-gtest-device.h>
+
+namespace xorg {
+namespace testing {
+namespace evemu {
+
+/**
+ * @class GestureGenerator xorg-gtest-gesture.h xorg/gtest/evemu/xorg-gtest-gesture.h
+ *
+ * Synthesizes multitouch gestures for a device supporting the multitouch
+ * protocol B.
+ *
+ * Each gesture appends frames of events to a buffer allocated once in the
+ * constructor. Frames are sampled at the sample rate along the trajectory
+ * of each finger and timestamped so Play() can replay them in real time.
+ * Positions are given in normalized coordinates, 0.0 to 1.0 across the
+ * device's ABS_MT_POSITION_X and ABS_MT_POSITION_Y ranges.
+ *
+ * @code
+ * GestureGenerator gestures(device);
+ * gestures.Scroll(0.5, 0.3, 0, 0.4, 200);
+ * gestures.Play();
+ * gestures.Clear();
+ * @endcode
+ */
+class GestureGenerator {
+ public:
+  /**
+   * Trajectory of the fingers of a gesture.
+   */
+  class Trajectory {
+   public:
+    virtual ~Trajectory() {}
+
+    /**
+     * Return the position of a finger.
+     *
+     * @param [in] finger The finger, from 0 to the number of fingers - 1.
+     * @param [in] t Time from 0.0 at the start to 1.0 at the end of the
+     *             gesture.
+     * @param [out] x Normalized x position.
+     * @param [out] y Normalized y position.
+     */
+    virtual void Position(unsigned int finger, double t,
+                          double *x, double *y) const = 0;
+  };
+
+  /**
+   * Create a generator for the given device.
+   *
+   * @param [in] device The device to generate gestures for. It must
+   *             outlive the generator.
+   * @param [in] max_events Size of the event buffer.
+   *
+   * @throws std::runtime_error if the device does not support ABS_MT_SLOT,
+   *         ABS_MT_TRACKING_ID and ABS_MT_POSITION_X/Y.
+   */
+  explicit GestureGenerator(Device &device, unsigned int max_events = 16384);
+  ~GestureGenerator();
+
+  /**
+   * Set the number of frames per second. The default is 100.
+   */
+  void SetSampleRate(unsigned int rate);
+
+  /**
+   * @return The number of frames per second.
+   */
+  unsigned int GetSampleRate() const;
+
+  /**
+   * @return The number of touches the device can track at once.
+   */
+  unsigned int GetSlotCount() const;
+
+  /**
+   * Generate a gesture along an arbitrary trajectory. All other gestures
+   * are built on this one.
+   *
+   * The fingers touch down in the first frame, move in each following
+   * frame and lift off in an extra frame at the end.
+   *
+   * @param [in] fingers Number of fingers.
+   * @param [in] trajectory The positions of the fingers over time.
+   * @param [in] duration Duration in ms from touch down to the last move.
+   *
+   * @throws std::runtime_error if the device has fewer slots than fingers
+   *         or the buffer is full.
+   */
+  void Touch(unsigned int fingers, const Trajectory &trajectory,
+             double duration);
+
+  /**
+   * Move fingers side by side in a straight line.
+   *
+   * @param [in] fingers Number of fingers.
+   * @param [in] x Start position of the center of the fingers.
+   * @param [in] y Start position of the center of the fingers.
+   * @param [in] dx Horizontal distance to move.
+   * @param [in] dy Vertical distance to move.
+   * @param [in] duration Duration in ms.
+   */
+  void Swipe(unsigned int fingers, double x, double y, double dx, double dy,
+             double duration);
+
+  /**
+   * A two-finger swipe, the usual scroll gesture.
+   */
+  void Scroll(double x, double y, double dx, double dy, double duration);
+
+  /**
+   * Move fingers, evenly spread on a circle, towards or away from its
+   * center.
+   *
+   * @param [in] fingers Number of fingers.
+   * @param [in] x Center of the circle.
+   * @param [in] y Center of the circle.
+   * @param [in] start_radius Radius at the start.
+   * @param [in] end_radius Radius at the end.
+   * @param [in] duration Duration in ms.
+   */
+  void Pinch(unsigned int fingers, double x, double y, double start_radius,
+             double end_radius, double duration);
+
+  /**
+   * Move fingers, evenly spread on a circle, around its center.
+   *
+   * @param [in] fingers Number of fingers.
+   * @param [in] x Center of the circle.
+   * @param [in] y Center of the circle.
+   * @param [in] radius Radius of the circle.
+   * @param [in] angle Angle to rotate by in radians, positive is clockwise.
+   * @param [in] duration Duration in ms.
+   */
+  void Rotate(unsigned int fingers, double x, double y, double radius,
+              double angle, double duration);
+
+  /**
+   * Put fingers down side by side and lift them again without moving.
+   *
+   * @param [in] fingers Number of fingers.
+   * @param [in] x Center of the fingers.
+   * @param [in] y Center of the fingers.
+   * @param [in] duration Duration in ms the fingers stay down.
+   */
+  void Tap(unsigned int fingers, double x, double y, double duration = 50);
+
+  /**
+   * Play the generated frames through the device with
+   * Device::PlayFrames().
+   */
+  void Play(Device::PlaybackMode mode = Device::PLAYBACK_FAST,
+            double factor = 1.0) const;
+
+  /**
+   * @return The generated events.
+   */
+  const struct input_event* GetEvents() const;
+
+  /**
+   * @return The number of generated events.
+   */
+  unsigned int GetEventCount() const;
+
+  /**
+   * @return The index of the first event of each frame, followed by the
+   *         number of events.
+   */
+  const uint32_t* GetFrameOffsets() const;
+
+  /**
+   * @return The number of generated frames.
+   */
+  unsigned int GetFrameCount() const;
+
+  /**
+   * Drop all generated frames. The buffer is kept for the next gestures.
+   */
+  void Clear();
+
+ private:
+  struct Private;
+  std::auto_ptr<Private> d_;
+
+  /* Disable copy constructor & assignment operator */
+  GestureGenerator(const GestureGenerator&);
+  GestureGenerator& operator=(const GestureGenerator&);
+};
+
+} // namespace evemu
+} // namespace testing
+} // namespace xorg
+
+#endif // XORG_GTEST_EVEMU_GESTURE_H_
@@ -0,0 +1,224 @@
+/*******************************************************************************
+ *
+ * X testing environment - typed access to XI device properties
+ *
+ * Copyright © 2026 xorg-gtest contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ ******************************************************************************/
+
+#ifndef XORG_GTEST_DEVICEPROPERTIES_H
+#define XORG_GTEST_DEVICEPROPERTIES_H
+
+#include <ctime>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <X11/Xlib.h>
+
+namespace xorg {
+namespace testing {
+
+/**
+ * @class DeviceProperties xorg-gtest-deviceproperties.h xorg/gtest/xorg-gtest-deviceproperties.h
+ *
+ * Typed access to the XI2 properties of one input device.
+ *
+ * Property values are read on first access and cached. Writes are
+ * queued and sent together by Flush(), which syncs with the server once.
+ *
+ * @code
+ * DeviceProperties props(Display(), deviceid);
+ * std::vector<std::string> names;
+ * names.push_back("Synaptics Tap Time");
+ * names.push_back("Coordinate Transformation Matrix");
+ * props.Fetch(names);
+ *
+ * props.SetIntegers("Synaptics Tap Time", std::vector<long>(1, 100));
+ * props.SetFloats("Coordinate Transformation Matrix", matrix);
+ * ASSERT_TRUE(props.Flush());
+ * @endcode
+ *
+ * Property names are resolved through the DisplayCache. Xlib offers no
+ * way to have several XIGetProperty() requests in flight, so each
+ * property read is a round trip, but only the first.
+ */
+class DeviceProperties {
+ public:
+  /**
+   * Creates a helper for the properties of the given device.
+   *
+   * @param display The display connection.
+   * @param deviceid The XI2 device id.
+   */
+  DeviceProperties(::Display *display, int deviceid);
+
+  ~DeviceProperties();
+
+  /**
+   * Reads the given properties from the server, replacing the values
+   * cached. The property names are interned in one round trip.
+   *
+   * @param properties The property names.
+   */
+  void Fetch(const std::vector<std::string> &properties);
+
+  /**
+   * Drops all cached values, the next access reads from the server again.
+   */
+  void Invalidate();
+
+  /**
+   * @param property The property name.
+   *
+   * @return true if the device has the property.
+   */
+  bool Has(const std::string &property);
+
+  /**
+   * @param property The property name.
+   *
+   * @return The format of the property, 8, 16 or 32, or 0 if the device
+   * does not have it.
+   */
+  int GetFormat(const std::string &property);
+
+  /**
+   * Returns the values of an integer property. Values of type INTEGER are
+   * sign-extended, all others are treated as unsigned.
+   *
+   * @param property The property name.
+   *
+   * @return The values.
+   *
+   * @throws std::runtime_error if the device does not have the property.
+   */
+  std::vector<long> GetIntegers(const std::string &property);
+
+  /**
+   * Returns the values of a property of type FLOAT.
+   *
+   * @param property The property name.
+   *
+   * @return The values.
+   *
+   * @throws std::runtime_error if the device does not have the property or
+   * its type is not FLOAT.
+   */
+  std::vector<float> GetFloats(const std::string &property);
+
+  /**
+   * Returns the values of a property of type ATOM.
+   *
+   * @param property The property name.
+   *
+   * @return The atoms.
+   *
+   * @throws std::runtime_error if the device does not have the property or
+   * its type is not ATOM.
+   */
+  std::vector<Atom> GetAtoms(const std::string &property);
+
+  /**
+   * Returns the value of a property of type STRING.
+   *
+   * @param property The property name.
+   *
+   * @return The string.
+   *
+   * @throws std::runtime_error if the device does not have the property or
+   * its type is not STRING.
+   */
+  std::string GetString(const std::string &property);
+
+  /**
+   * Queues a write of an integer property. The property keeps its type
+   * and format, if the device does not have the property it is created
+   * as a 32 bit INTEGER property.
+   *
+   * @param property The property name.
+   * @param values The values.
+   */
+  void SetIntegers(const std::string &property, const std::vector<long> &values);
+
+  /**
+   * Queues a write of a FLOAT property.
+   *
+   * @param property The property name.
+   * @param values The values.
+   */
+  void SetFloats(const std::string &property, const std::vector<float> &values);
+
+  /**
+   * Queues a write of an ATOM property.
+   *
+   * @param property The property name.
+   * @param values The atoms.
+   */
+  void SetAtoms(const std::string &property, const std::vector<Atom> &values);
+
+  /**
+   * Sends all queued writes and syncs with the server once.
+   *
+   * @return true if the server accepted all writes. Otherwise the cache
+   * is dropped, since it is unknown which writes took effect.
+   */
+  bool Flush();
+
+  /**
+   * Waits until an integer property has the given values. Instead of
+   * polling, the property is only read again when the server reports a
+   * change through an XI_PropertyEvent.
+   *
+   * The root window's XI2 event selection is extended for the duration of
+   * the call, other events received in the meantime are discarded.
+   *
+   * @param property The property name.
+   * @param values The values to wait for.
+   * @param timeout The timeout in milliseconds.
+   *
+   * @return true if the property had the values before the timeout.
+   */
+  bool WaitForPropertyValue(const std::string &property,
+                            const std::vector<long> &values,
+                            time_t timeout = 1000);
+
+  /**
+   * Like WaitForPropertyValue() for integers, for a FLOAT property.
+   */
+  bool WaitForPropertyValue(const std::string &property,
+                            const std::vector<float> &values,
+                            time_t timeout = 1000);
+
+ private:
+  struct Private;
+  std::auto_ptr<Private> d_;
+
+  /* Disable copy constructor & assignment operator */
+  DeviceProperties(const DeviceProperties&);
+  DeviceProperties& operator=(const DeviceProperties&);
+};
+
+} // namespace testing
+} // namespace xorg
+
+#endif // XORG_GTEST_DEVICEPROPERTIES_H
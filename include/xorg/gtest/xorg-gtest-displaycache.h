@@ -0,0 +1,130 @@
+/*******************************************************************************
+ *
+ * X testing environment - per-display cache of atoms and extensions
+ *
+ * Copyright © 2026 xorg-gtest contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ ******************************************************************************/
+
+#ifndef XORG_GTEST_DISPLAYCACHE_H
+#define XORG_GTEST_DISPLAYCACHE_H
+
+#include <string>
+#include <vector>
+
+#include <X11/Xlib.h>
+
+namespace xorg {
+namespace testing {
+
+/**
+ * @class DisplayCache xorg-gtest-displaycache.h xorg/gtest/xorg-gtest-displaycache.h
+ *
+ * Per-display cache of atoms and extension opcodes.
+ *
+ * Interning an atom or querying an extension costs a round trip to the
+ * server each time. The cache resolves each atom and extension once per
+ * display connection, and resolves all atoms missing from a list in a
+ * single round trip. The cache of a display is dropped when the display
+ * is closed.
+ *
+ * All functions are thread-safe.
+ */
+class DisplayCache {
+ public:
+  /**
+   * Returns the atom for the given name, interning it if needed.
+   *
+   * @param display The display connection.
+   * @param name The atom name.
+   *
+   * @return The atom.
+   *
+   * @throws std::runtime_error if the atom cannot be interned.
+   */
+  static Atom GetAtom(::Display *display, const std::string &name);
+
+  /**
+   * Returns the atoms for a list of names. All atoms not cached yet are
+   * interned in one round trip.
+   *
+   * @param display The display connection.
+   * @param names The atom names.
+   * @param [out] atoms The atoms, in the order of the names.
+   *
+   * @throws std::runtime_error if the atoms cannot be interned.
+   */
+  static void GetAtoms(::Display *display, const std::vector<std::string> &names,
+                       std::vector<Atom> *atoms);
+
+  /**
+   * Returns the name of an atom. The atom must exist, the server replies
+   * to unknown atoms with a BadAtom error.
+   *
+   * @param display The display connection.
+   * @param atom The atom.
+   *
+   * @return The name of the atom, or an empty string on error.
+   */
+  static std::string GetAtomName(::Display *display, Atom atom);
+
+  /**
+   * Like XQueryExtension(), but only the first call for a display and
+   * extension goes to the server.
+   *
+   * @param display The display connection.
+   * @param name The extension name, e.g. "XInputExtension".
+   * @param [out] opcode The major opcode of the extension, may be NULL.
+   * @param [out] event_base The first event of the extension, may be NULL.
+   * @param [out] error_base The first error of the extension, may be NULL.
+   *
+   * @return true if the server supports the extension.
+   */
+  static bool QueryExtension(::Display *display, const std::string &name,
+                             int *opcode, int *event_base, int *error_base);
+
+  /**
+   * @return The number of atoms, atom names and extensions found in the
+   * cache since the last call to ResetStatistics().
+   */
+  static unsigned long GetHits();
+
+  /**
+   * @return The number of atoms, atom names and extensions that had to be
+   * requested from the server since the last call to ResetStatistics().
+   */
+  static unsigned long GetMisses();
+
+  /**
+   * Resets the hit and miss counters.
+   */
+  static void ResetStatistics();
+
+ private:
+  /* Not instantiable */
+  DisplayCache();
+};
+
+} // namespace testing
+} // namespace xorg
+
+#endif // XORG_GTEST_DISPLAYCACHE_H
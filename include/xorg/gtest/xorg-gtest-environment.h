@@ -37,6 +37,8 @@
 namespace xorg {
 namespace testing {
 
+class XServer;
+
 /**
  * \mainpage X.org Google %Test Framework
  *
@@ -66,6 +68,17 @@ namespace testing {
  */
 class Environment : public ::testing::Environment {
  public:
+  /**
+   * How the server state is reset between tests, see SetResetMode().
+   */
+  enum ResetMode {
+    RESET_NONE,    /**< Tests see whatever state previous tests left behind */
+    RESET_CLIENTS, /**< Kill leftover clients and restore device properties,
+                        pointer and keyboard state after each test */
+    RESET_REGENERATE, /**< Regenerate the server after each test */
+    RESET_RESTART, /**< Restart the server after each test */
+  };
+
   /**
    * Constructs an object to provide a global X server dummy environment.
    */
@@ -140,6 +153,182 @@ class Environment : public ::testing::Environment {
    */
   int GetDisplayNumber() const;
 
+  /**
+   * Sets how the server state is reset between tests. The default is
+   * RESET_NONE. This must be set before the environment is set up to have
+   * any effect.
+   *
+   * The modes are ordered by increasing cost and isolation. With any mode
+   * but RESET_NONE, the environment keeps its own connection to the server
+   * and takes a snapshot of the server state after startup. After each
+   * test, Reset() is called to bring the server back to this snapshot.
+   *
+   * @param mode The reset mode to use.
+   */
+  void SetResetMode(enum ResetMode mode);
+
+  /**
+   * Returns the reset mode used between tests.
+   *
+   * @return The current reset mode.
+   */
+  enum ResetMode GetResetMode() const;
+
+  /**
+   * Resets the server to the snapshot taken after startup.
+   *
+   * With RESET_CLIENTS, all clients except the environment's own
+   * connection are killed and the properties of all input devices present
+   * at startup, the pointer position, the input focus and the locked
+   * keyboard modifiers are restored. With RESET_REGENERATE, the server is
+   * regenerated, see XServer::Regenerate(). With RESET_RESTART, the server
+   * is restarted.
+   *
+   * If the server state still differs from the snapshot afterwards, or
+   * regeneration fails, the server is restarted.
+   *
+   * This function is called automatically after each test unless the reset
+   * mode is RESET_NONE, in which case it does nothing.
+   *
+   * @return true if the server was reset to the snapshot, false if it had to
+   *         be restarted.
+   */
+  bool Reset();
+
+  /**
+   * Sets whether the server is started lazily. This must be set before the
+   * environment is set up to have any effect.
+   *
+   * By default, the server is started in SetUp() unless all test cases
+   * selected to run were declared with XORG_GTEST_NO_SERVER(). A lazy
+   * environment never starts the server in SetUp(). Instead, the server is
+   * started on first use through RequireServer(), which
+   * xorg::testing::Test::SetUp() calls for all tests using that fixture.
+   *
+   * The DISPLAY environment variable is set in SetUp() either way.
+   *
+   * @param lazy true to start the server on first use only.
+   */
+  void SetLazyStart(bool lazy);
+
+  /**
+   * Starts the server of the environment currently set up, unless it is
+   * running already. Does nothing if no environment is set up.
+   *
+   * @throws std::runtime_error if the server cannot be started.
+   */
+  static void RequireServer();
+
+  /**
+   * Declares that a test case does not need an X server. Use
+   * XORG_GTEST_NO_SERVER() instead of calling this function directly.
+   *
+   * @param test_case_name The name of the test case.
+   *
+   * @return Always true
+   */
+  static bool RegisterNoServerTestCase(const std::string &test_case_name);
+
+  /**
+   * Sets whether the server is restarted if it crashes. The default is
+   * true.
+   *
+   * If enabled, Recover() is called after each test. If the server died
+   * during the test, the test is marked as failed with the last lines of
+   * the server log attached, and the run continues with a new server. The
+   * number of crashes and the time lost to them is printed at the end of
+   * the run.
+   *
+   * @param restart false to leave a crashed server alone.
+   */
+  void SetRestartOnCrash(bool restart);
+
+  /**
+   * Returns whether the server is restarted if it crashes.
+   *
+   * @return true if a crashed server is restarted.
+   */
+  bool GetRestartOnCrash() const;
+
+  /**
+   * Restarts the server with the same options if it died. The log of the
+   * dead server is moved to the log file path with ".crash" appended.
+   *
+   * A server stopped through Kill() is not restarted.
+   *
+   * @return true if the server had died and was restarted, false if it is
+   *         still running or was not started.
+   *
+   * @throws std::runtime_error if the server cannot be restarted.
+   */
+  bool Recover();
+
+  /**
+   * Adds another server to the environment, e.g. to compare two drivers
+   * or to test clients talking to several servers. This must be called
+   * before the environment is set up.
+   *
+   * The server uses the configuration file and server path set at the time
+   * of the call and a log file named after the tag. The returned server
+   * may be configured further before the environment is set up.
+   *
+   * All servers are started together with the server of the environment,
+   * without waiting for one to be ready before starting the next, see
+   * XServer::SetPrebindSocket(). Reset() and Recover() only apply to the
+   * server of the environment.
+   *
+   * @param tag A unique name to look up the server with.
+   * @param display_num The display number of the server.
+   *
+   * @return The server added.
+   *
+   * @throws std::runtime_error if a server with this tag exists.
+   */
+  XServer& AddServer(const std::string &tag, int display_num);
+
+  /**
+   * Returns the number of servers in this environment, including the
+   * server configured through SetConfigFile() etc.
+   *
+   * @return The number of servers.
+   */
+  unsigned int GetServerCount() const;
+
+  /**
+   * Returns a server of this environment. The server configured through
+   * SetConfigFile() etc. has the index 0 and the tag "default", servers
+   * added with AddServer() follow in the order they were added.
+   *
+   * @param index The index of the server.
+   *
+   * @return The server.
+   *
+   * @throws std::runtime_error if the index is out of range.
+   */
+  XServer& GetServer(unsigned int index);
+
+  /**
+   * Returns the server with the given tag.
+   *
+   * @param tag The tag passed to AddServer(), or "default".
+   *
+   * @return The server.
+   *
+   * @throws std::runtime_error if no server has this tag.
+   */
+  XServer& GetServer(const std::string &tag);
+
+  /**
+   * Returns the server assigned to the calling thread. Threads are
+   * assigned the servers round-robin on their first call, later calls
+   * from the same thread return the same server.
+   *
+   * This function is thread-safe.
+   *
+   * @return The server of the calling thread.
+   */
+  XServer& AssignServer();
+
   /**
    * Kill the dummy Xorg server with SIGKILL.
    */
@@ -231,4 +420,21 @@ class Environment : public ::testing::Environment {
 } // namespace testing
 } // namespace xorg
 
+/**
+ * Declare that the given test case does not need an X server. If only such
+ * test cases are selected to run, e.g. through --gtest_filter, the
+ * environment does not start a server.
+ *
+ * @code
+ * XORG_GTEST_NO_SERVER(Process);
+ *
+ * TEST(Process, ExitCodeSuccess) {
+ *   ...
+ * }
+ * @endcode
+ */
+#define XORG_GTEST_NO_SERVER(test_case_name) \
+  static bool xorg_gtest_no_server_##test_case_name GTEST_ATTRIBUTE_UNUSED_ = \
+    xorg::testing::Environment::RegisterNoServerTestCase(#test_case_name)
+
 #endif // XORG_GTEST_ENVIRONMENT_H
@@ -0,0 +1,275 @@
+/*******************************************************************************
+ *
+ * X testing environment - Google Test fixture for many concurrent clients
+ *
+ * Copyright © 2026 xorg-gtest contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ ******************************************************************************/
+
+#ifndef XORG_GTEST_MULTICLIENT_H
+#define XORG_GTEST_MULTICLIENT_H
+
+#include <memory>
+#include <ostream>
+
+#include "xorg-gtest-test.h"
+
+namespace xorg {
+namespace testing {
+
+/**
+ * @class LatencyHistogram xorg-gtest-multiclient.h xorg/gtest/xorg-gtest-multiclient.h
+ *
+ * Histogram of request latencies with logarithmic buckets. Bucket i
+ * counts the latencies from 2^i to 2^(i+1) - 1 microseconds, bucket 0
+ * also counts latencies below one microsecond.
+ */
+class LatencyHistogram {
+ public:
+  /** The number of buckets */
+  static const unsigned int NUM_BUCKETS = 32;
+
+  LatencyHistogram();
+
+  /**
+   * Adds a latency to the histogram.
+   *
+   * @param usec The latency in microseconds.
+   */
+  void Add(unsigned long usec);
+
+  /**
+   * Adds all latencies of another histogram to this one.
+   *
+   * @param other The histogram to add.
+   */
+  void Merge(const LatencyHistogram &other);
+
+  /**
+   * @return The number of latencies added.
+   */
+  unsigned long GetCount() const;
+
+  /**
+   * @return The number of latencies in the given bucket.
+   */
+  unsigned long GetBucket(unsigned int bucket) const;
+
+  /**
+   * @return The lowest latency added in microseconds, 0 if empty.
+   */
+  unsigned long GetMin() const;
+
+  /**
+   * @return The highest latency added in microseconds, 0 if empty.
+   */
+  unsigned long GetMax() const;
+
+  /**
+   * @return The mean latency in microseconds, 0 if empty.
+   */
+  double GetMean() const;
+
+  /**
+   * Returns an upper bound for the given percentile, i.e. the upper limit
+   * of the bucket the percentile falls into, capped by GetMax().
+   *
+   * @param percentile The percentile, from 0 to 100.
+   *
+   * @return The latency in microseconds, 0 if empty.
+   */
+  unsigned long GetPercentile(double percentile) const;
+
+ private:
+  unsigned long buckets_[NUM_BUCKETS];
+  unsigned long count_;
+  unsigned long min_;
+  unsigned long max_;
+  unsigned long long sum_;
+};
+
+/**
+ * Prints count, mean, p50, p99 and max of a histogram on one line.
+ */
+std::ostream& operator<<(std::ostream &os, const LatencyHistogram &histogram);
+
+/**
+ * @class MultiClientTest xorg-gtest-multiclient.h xorg/gtest/xorg-gtest-multiclient.h
+ *
+ * Google %Test fixture driving many concurrent client connections.
+ *
+ * In addition to Display(), the fixture opens a number of client
+ * connections with OpenClients(). Run() then sends a mix of requests on
+ * all clients concurrently, each client on its own thread, and records
+ * the latency of each request per client.
+ *
+ * @code
+ * class Stress : public xorg::testing::MultiClientTest {
+ *  public:
+ *   Stress() {
+ *     SetServerScope(SCOPE_PER_SUITE);
+ *     SetMaxClients(2048);
+ *   }
+ * };
+ *
+ * TEST_F(Stress, Atoms) {
+ *   AddRequest(REQUEST_INTERN_ATOM, 3);
+ *   AddRequest(REQUEST_CREATE_WINDOW);
+ *   ASSERT_EQ(OpenClients(1000), 1000U);
+ *   Run(100);
+ *   std::cout << GetTotalLatency() << "\n";
+ * }
+ * @endcode
+ *
+ * The constructor calls XInitThreads(). With older versions of libX11, it
+ * must be called before any other Xlib function, i.e. at the start of
+ * main(), instead.
+ */
+class MultiClientTest : public Test {
+ public:
+  /**
+   * Requests a client may send during Run(). Each request is followed by
+   * a round trip to the server to measure its latency.
+   */
+  enum Request {
+    REQUEST_SYNC,            /**< A round trip only */
+    REQUEST_INTERN_ATOM,     /**< Intern an existing atom */
+    REQUEST_QUERY_POINTER,   /**< Query the pointer position */
+    REQUEST_CHANGE_PROPERTY, /**< Change a property on the client's window */
+    REQUEST_CREATE_WINDOW,   /**< Create, map and destroy a window */
+  };
+
+  MultiClientTest();
+
+  virtual ~MultiClientTest();
+
+ protected:
+  /**
+   * Closes all client connections, then calls Test::TearDown().
+   */
+  virtual void TearDown();
+
+  /**
+   * Adds -maxclients to the server options if SetMaxClients() was called.
+   * Reimplemented from xorg::testing::Test, fixtures that reimplement this
+   * function must call it.
+   */
+  virtual void ConfigureServer(XServer &server);
+
+  /**
+   * Sets the maximum number of clients the server accepts, passed to the
+   * server as -maxclients. Only has an effect if the fixture starts its
+   * own server, see Test::SetServerScope(). Xorg accepts 64, 128, 256,
+   * 512, 1024 and 2048, the default is 256.
+   *
+   * @param max_clients The maximum number of clients.
+   */
+  void SetMaxClients(unsigned int max_clients);
+
+  /**
+   * Adds a request to the mix sent by Run(). Each client picks the
+   * requests at random according to their weights. If no request was
+   * added, Run() sends REQUEST_SYNC only.
+   *
+   * @param request The request.
+   * @param weight The relative frequency of the request.
+   */
+  void AddRequest(enum Request request, unsigned int weight = 1);
+
+  /**
+   * Opens client connections to the display Display() is connected to.
+   * Stops at the first connection that cannot be opened, e.g. because the
+   * server refuses more clients.
+   *
+   * The file descriptor limit of the process is raised as far as allowed
+   * to fit the connections.
+   *
+   * @param count The number of connections to open.
+   *
+   * @return The number of connections opened.
+   */
+  unsigned int OpenClients(unsigned int count);
+
+  /**
+   * Sends requests on all clients concurrently, each client on its own
+   * thread. All threads start sending at the same time.
+   *
+   * A client whose connection is lost stops sending and is counted by
+   * GetFailedClients().
+   *
+   * @param requests The number of requests each client sends.
+   */
+  void Run(unsigned int requests);
+
+  /**
+   * @return The number of open client connections.
+   */
+  unsigned int GetClientCount() const;
+
+  /**
+   * @return The number of clients that lost their connection in Run().
+   */
+  unsigned int GetFailedClients() const;
+
+  /**
+   * Returns a client connection. It must not be used while Run() is
+   * active.
+   *
+   * @param index The index of the client.
+   *
+   * @return The connection.
+   */
+  ::Display* Client(unsigned int index) const;
+
+  /**
+   * Returns the latencies of the requests sent by one client in all calls
+   * to Run().
+   *
+   * @param index The index of the client.
+   *
+   * @return The latency histogram of the client.
+   */
+  const LatencyHistogram& GetLatency(unsigned int index) const;
+
+  /**
+   * @return The latencies of all requests of all clients.
+   */
+  LatencyHistogram GetTotalLatency() const;
+
+  /**
+   * @return The time it took to open the connections in OpenClients().
+   */
+  const LatencyHistogram& GetConnectLatency() const;
+
+ private:
+  struct Private;
+  std::auto_ptr<Private> d_;
+
+  /* Disable copy c'tor, assignment operator */
+  MultiClientTest(const MultiClientTest&);
+  MultiClientTest& operator=(const MultiClientTest&);
+};
+
+} // namespace testing
+} // namespace xorg
+
+#endif // XORG_GTEST_MULTICLIENT_H
@@ -78,7 +78,8 @@ class Process {
      NONE,              /**< The process has not been started yet */
      RUNNING,           /**< The process has been started */
      FINISHED_SUCCESS,  /**< The process finished with an exit code of 0 */
-     FINISHED_FAILURE,  /**< The process finished with a non-zero exit code */
+     FINISHED_FAILURE,  /**< The process finished with a non-zero exit code
+                             or was killed by a signal */
      TERMINATED,        /**< The process was successfully terminated by this
                              library but it's state is currently unknown */
    };
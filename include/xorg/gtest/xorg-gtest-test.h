@@ -37,6 +37,8 @@
 namespace xorg {
 namespace testing {
 
+class XServer;
+
 /**
  * @class Test xorg-gtest-test.h xorg/gtest/xorg-gtest-test.h
  *
@@ -47,19 +49,53 @@ namespace testing {
  * own tests or subclass it and override the SetUp and TearDown
  * methods.
  *
- * @remark The display port is read from the environment variable DISPLAY.
+ * @remark The display port is read from the environment variable DISPLAY,
+ * unless the fixture uses its own server, see SetServerScope().
  */
 class Test : public ::testing::Test {
  public:
+  /**
+   * Which server the tests of a fixture connect to, see SetServerScope().
+   */
+  enum ServerScope {
+    SCOPE_GLOBAL,    /**< The server given by DISPLAY, usually the one of
+                          the xorg::testing::Environment */
+    SCOPE_PER_SUITE, /**< One server shared by all tests of a test case */
+    SCOPE_PER_TEST,  /**< A new server for each test */
+  };
+
+  /**
+   * What to do about server resources that grew during a test, see
+   * SetLeakCheck().
+   */
+  enum LeakCheck {
+    LEAK_CHECK_NONE,     /**< Don't check */
+    LEAK_CHECK_ANNOTATE, /**< Print the growth and record it as a test
+                              property */
+    LEAK_CHECK_FAIL,     /**< Fail the test */
+  };
 
   Test();
 
   virtual ~Test();
 
+  /**
+   * Stops the server shared by the tests of the test case, if any.
+   *
+   * Reimplemented from ::testing::Test. Fixtures that implement their own
+   * TearDownTestCase() must call this function.
+   */
+  static void TearDownTestCase();
+
  protected:
   /**
    * Tries to connect to an X server instance.
    *
+   * If no display string was set, the server of the fixture is started
+   * first depending on the server scope, see SetServerScope(). With
+   * SCOPE_GLOBAL, the server of a lazily started xorg::testing::Environment
+   * is started first, see Environment::SetLazyStart().
+   *
    * Fails if no X server is running. Updates the display object.
    * Reimplemented from ::testing::Test. See Google %Test documentation for
    * details.
@@ -71,7 +107,8 @@ class Test : public ::testing::Test {
   virtual void SetUp();
 
   /**
-   * Closes the display.
+   * Closes the display, or returns it to the pool of connections, see
+   * SetConnectionPooling().
    *
    * Reimplemented from ::testing::Test. See Google %Test documentation for
    * details.
@@ -99,11 +136,101 @@ class Test : public ::testing::Test {
    */
   void SetDisplayString(const std::string &display);
 
+  /**
+   * Sets which server the tests of this fixture connect to. The default is
+   * SCOPE_GLOBAL. This function must be called before
+   * xorg::testing::Test::SetUp() to have any effect, usually in the
+   * constructor of the fixture.
+   *
+   * Test cases that only read the server state can share a server with
+   * SCOPE_PER_SUITE: it is started in the SetUp() of the first test of the
+   * test case and stopped in TearDownTestCase(). Test cases that leave
+   * state behind can use SCOPE_PER_TEST to get a new server for each test.
+   *
+   * These servers use the first display above the Environment's default
+   * display that has neither a lock file nor a socket, so they can run
+   * next to the servers of an xorg::testing::Environment and of other
+   * processes. If no test needs the Environment's server,
+   * see Environment::SetLazyStart() and XORG_GTEST_NO_SERVER().
+   *
+   * A display string set with SetDisplayString() takes precedence over
+   * the server scope.
+   *
+   * @code
+   * class ReadOnlyTest : public xorg::testing::Test {
+   *  public:
+   *   ReadOnlyTest() { SetServerScope(SCOPE_PER_SUITE); }
+   * };
+   * @endcode
+   *
+   * @param scope The server scope.
+   */
+  void SetServerScope(enum ServerScope scope);
+
+  /**
+   * Sets whether the display connection is reused between tests. This
+   * function must be called before xorg::testing::Test::SetUp() to have
+   * any effect, usually in the constructor of the fixture.
+   *
+   * With pooling, TearDown() does not close the connection. Instead, the
+   * event selections on the root window are cleared, grabs are released,
+   * top-level windows created on the connection are destroyed and pending
+   * events and errors are discarded. The next test connecting to the same
+   * display then gets this connection instead of a new one. Other
+   * resources created on the connection are not freed.
+   *
+   * Connections closed by the server in the meantime, e.g. by a reset of
+   * the xorg::testing::Environment other than RESET_NONE or because the
+   * server was stopped, are replaced by a new connection.
+   *
+   * @param pool true to reuse the display connection.
+   * @param prewarm true to open a spare connection in TearDown() if the
+   * connection could not be kept, so the next test need not wait for it.
+   */
+  void SetConnectionPooling(bool pool, bool prewarm = false);
+
+  /**
+   * Sets whether the server resources are compared before and after each
+   * test. The default is LEAK_CHECK_NONE. This function must be called
+   * before xorg::testing::Test::SetUp() to have any effect, usually in the
+   * constructor of the fixture.
+   *
+   * The resources of all clients are counted through the X-Resource
+   * extension at the end of SetUp() and again in TearDown(), after
+   * Display() was closed and its resources freed by the server. If the
+   * number of windows or pixmaps or the pixmap memory grew, all resource
+   * types that grew are reported.
+   *
+   * @param check What to do if resources grew.
+   */
+  void SetLeakCheck(enum LeakCheck check);
+
+  /**
+   * Configures a server of this fixture before it is started. Only called
+   * if the server scope is not SCOPE_GLOBAL.
+   *
+   * The default implementation does nothing. The server has the dummy
+   * configuration and a log file named after the test case, or the test
+   * with SCOPE_PER_TEST, in the log file directory set already.
+   *
+   * @param server The server to configure.
+   */
+  virtual void ConfigureServer(XServer &server);
+
+  /**
+   * Returns the server this test is connected to.
+   *
+   * @return The server of this fixture, or NULL with SCOPE_GLOBAL.
+   */
+  XServer* Server() const;
+
   /** @cond Implementation */
   struct Private;
   std::auto_ptr<Private> d_;
   /** @endcond Implementation */
  private:
+  void CheckResources(XID closed_client);
+
   /* Disable copy c'tor, assignment operator */
   Test(const Test&);
   Test& operator=(const Test&);
@@ -0,0 +1,195 @@
+/*******************************************************************************
+ *
+ * X testing environment - Google Test helper class to generate server configurations
+ *
+ * Copyright © 2026 xorg-gtest contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ ******************************************************************************/
+
+#ifndef XORG_GTEST_XORGCONFIG_H
+#define XORG_GTEST_XORGCONFIG_H
+
+#include <memory>
+#include <string>
+
+namespace xorg {
+namespace testing {
+
+/**
+ * @class XorgConfig xorg-gtest-xorgconfig.h xorg/gtest/xorg-gtest-xorgconfig.h
+ *
+ * Builder for xorg.conf files.
+ *
+ * The dummy.conf shipped with xorg-gtest only defines the dummy video
+ * device and leaves everything else to the server defaults. The server
+ * then loads all modules and extensions it knows of and hotplugs all input
+ * devices on the system. Most tests need none of this, an XorgConfig
+ * allows a test to declare only the parts it does need.
+ *
+ * @code
+ * XorgConfig config(XorgConfig::PROFILE_MINIMAL);
+ * config.AddInputDevice("--device--", "evdev");
+ * config.SetInputDeviceOption("--device--", "Device", "/dev/input/event0");
+ *
+ * XServer server;
+ * server.SetOption("-config", config.WriteConfig());
+ * server.Start();
+ * @endcode
+ *
+ * Config files are named after a hash of their contents. Writing the same
+ * configuration twice, even from different processes, results in the same
+ * file and the second write is skipped.
+ */
+class XorgConfig {
+ public:
+  /**
+   * The set of defaults a configuration starts with.
+   */
+  enum Profile {
+    PROFILE_DEFAULT, /**< Equivalent to dummy.conf, everything else is left
+                          to the server defaults */
+    PROFILE_MINIMAL, /**< Like PROFILE_DEFAULT, but without input device
+                          hotplugging, font path probing and the modules and
+                          extensions a test usually does not need */
+  };
+
+  /**
+   * Create a new configuration based on the given profile.
+   *
+   * @param [in] profile The profile to start with.
+   */
+  explicit XorgConfig(enum Profile profile = PROFILE_DEFAULT);
+
+  ~XorgConfig();
+
+  /**
+   * Explicitly load a module. Loading a module that was previously
+   * disabled removes it from the list of disabled modules.
+   *
+   * @param [in] module The module name, e.g. "evdev".
+   */
+  void LoadModule(const std::string &module);
+
+  /**
+   * Prevent a module from being loaded automatically.
+   *
+   * @param [in] module The module name, e.g. "glx".
+   */
+  void DisableModule(const std::string &module);
+
+  /**
+   * Enable or disable a server extension.
+   *
+   * @param [in] extension The extension name as listed in the log file, e.g.
+   *                       "Composite".
+   * @param [in] enabled Whether to enable or disable the extension.
+   */
+  void SetExtension(const std::string &extension, bool enabled);
+
+  /**
+   * Set an option in the ServerFlags section.
+   *
+   * @param [in] option The option name, e.g. "AutoAddDevices".
+   * @param [in] value The option value.
+   */
+  void SetServerFlag(const std::string &option, const std::string &value);
+
+  /**
+   * Enable or disable input device hotplugging. This is a shortcut for the
+   * ServerFlags AutoAddDevices option.
+   *
+   * @param [in] enabled Whether the server should add input devices itself.
+   */
+  void SetAutoAddDevices(bool enabled);
+
+  /**
+   * Add an InputDevice section and reference it from the server layout.
+   * Adding a device with an existing identifier replaces the driver of the
+   * existing device.
+   *
+   * @param [in] identifier The identifier of the device.
+   * @param [in] driver The input driver to use, e.g. "evdev".
+   */
+  void AddInputDevice(const std::string &identifier, const std::string &driver);
+
+  /**
+   * Set an option for a device added with AddInputDevice().
+   *
+   * @param [in] identifier The identifier of the device.
+   * @param [in] option The option name, e.g. "Device".
+   * @param [in] value The option value.
+   *
+   * @throws std::runtime_error if no device with this identifier exists.
+   */
+  void SetInputDeviceOption(const std::string &identifier,
+                            const std::string &option,
+                            const std::string &value);
+
+  /**
+   * Generate the configuration.
+   *
+   * @return The contents of the xorg.conf file for this configuration.
+   */
+  std::string GetContents() const;
+
+  /**
+   * Write the configuration to a file, unless a file with the same contents
+   * was written before. The file is not removed when this object is
+   * destroyed so subsequent test runs may reuse it.
+   *
+   * An existing file is only reused if it is owned by the effective user,
+   * not writable by anyone else and has the expected contents. Otherwise it
+   * is replaced.
+   *
+   * @param [in] directory The directory to write to. If empty, a directory
+   *                       private to the effective user is used, in
+   *                       /dev/shm if writable, otherwise in the log file
+   *                       directory.
+   *
+   * @throws std::runtime_error if the file could not be written.
+   *
+   * @return The path to the configuration file, suitable for the "-config"
+   *         server option.
+   */
+  const std::string& WriteConfig(const std::string &directory = "");
+
+  /**
+   * Get the path of the last file written by WriteConfig().
+   *
+   * @return The path to the configuration file or an empty string if
+   *         WriteConfig() has not been called yet.
+   */
+  const std::string& GetConfigPath() const;
+
+ private:
+  struct Private;
+  std::auto_ptr<Private> d_;
+
+  /* Disable copy constructor, assignment operator */
+  XorgConfig(const XorgConfig&);
+  XorgConfig& operator=(const XorgConfig&);
+};
+
+} // namespace testing
+} // namespace xorg
+
+#endif /* XORG_GTEST_XORGCONFIG_H */
@@ -34,6 +34,8 @@
 #include <xorg/gtest/xorg-gtest.h>
 #include <X11/Xlib.h>
 #include <stdexcept>
+#include <string>
+#include <vector>
 
 namespace xorg {
 namespace testing {
@@ -79,8 +81,18 @@ public:
  */
 class XServer : public xorg::testing::Process {
   public:
+    /**
+     * Linux namespace isolation modes, see SetIsolation().
+     */
+    enum Isolation {
+      ISOLATION_NONE,    /**< Share /tmp and the network with the host */
+      ISOLATION_MOUNT,   /**< Private /tmp in a new user and mount namespace */
+      ISOLATION_NETWORK, /**< Like ISOLATION_MOUNT, with an additional network
+                              namespace for private abstract sockets */
+    };
+
     XServer();
-    ~XServer();
+    virtual ~XServer();
 
     /**
      * Start a new server. If no binary is given, the server started is the
@@ -115,6 +127,26 @@ class XServer : public xorg::testing::Process {
      */
     virtual bool Kill(unsigned int timeout = 2000);
 
+    /**
+     * Regenerate the server. The server is sent SIGHUP, which makes it close
+     * all client connections and reset to its initial state without exiting.
+     * This is cheaper than terminating and starting a new server.
+     *
+     * All connections to the server are closed by the regeneration, close
+     * them before calling this function to avoid XIOErrors.
+     *
+     * The server signals it is ready again with SIGUSR1. This function
+     * installs a SIGUSR1 handler for the whole process, so it works no
+     * matter which thread the signal is delivered to.
+     *
+     * @param [in] timeout The timeout in millis to wait for the server to
+     *                     signal it is ready again.
+     *
+     * @returns true if the server signalled it is ready within the timeout,
+     *          false if it failed to regenerate or wasn't running.
+     */
+    bool Regenerate(unsigned int timeout = 3000);
+
     /**
      * Remove the log file used by this server. By default, this function
      * only removes the log file if the server was terminated or finished
@@ -141,6 +173,60 @@ class XServer : public xorg::testing::Process {
      */
     void SetDisplayNumber(unsigned int display_number);
 
+    /**
+     * Create and bind the server's listening socket before the server is
+     * started and hand it to the server with -listenfd.
+     *
+     * If enabled, Start() does not wait for the server to signal that it
+     * is ready but returns as soon as the server has been forked. Clients
+     * may call XOpenDisplay() immediately, the connection is queued on the
+     * socket until the server finishes initializing. This overlaps the
+     * client's connection setup with the server's startup.
+     *
+     * A server that fails to start is only noticed when the connection
+     * attempt fails. This option must be set before the server is started
+     * to have any effect.
+     *
+     * @param [in] prebind true to pre-bind the socket, false to wait for
+     *                     the server's SIGUSR1 instead (the default)
+     */
+    void SetPrebindSocket(bool prebind);
+
+    /**
+     * Start the server in private Linux namespaces. See Isolate() for
+     * details. This option must be set before the server is started to have
+     * any effect.
+     *
+     * @param [in] isolation The isolation mode, ISOLATION_NONE by default
+     */
+    void SetIsolation(enum Isolation isolation);
+
+    /**
+     * Move the calling process into a new unprivileged user and mount
+     * namespace (and network namespace for ISOLATION_NETWORK) with a private
+     * tmpfs on /tmp.
+     *
+     * Servers started afterwards and the clients of this process share the
+     * private /tmp, so the socket directory, lock files and, with the default
+     * log file directory, log files are invisible to other processes.
+     * With ISOLATION_NETWORK, parallel test processes can all use the same
+     * display number, including :0. Everything is cleaned up when the
+     * process exits.
+     *
+     * Isolation applies to the whole process and cannot be undone. The
+     * process must not have started any threads yet. Calling this function
+     * again after a successful call does nothing.
+     *
+     * This function is called by Start() if an isolation mode was set with
+     * SetIsolation(). Call it early in main() if the process uses threads.
+     *
+     * @param [in] isolation The isolation mode
+     *
+     * @throws std::runtime_error if the namespaces could not be created,
+     *         e.g. because unprivileged user namespaces are disabled.
+     */
+    static void Isolate(enum Isolation isolation);
+
     /**
      * Set the path to the server binary to be started. Optional call, if
      * not invoked the built-in default path is chosen.
@@ -224,6 +310,27 @@ class XServer : public xorg::testing::Process {
      */
     static bool WaitForDevice(::Display *display, const std::string &name, time_t timeout = 1000);
 
+    /**
+     * Wait for several devices to be added to the server.
+     *
+     * All devices share one timeout. Like WaitForDevice(), a name is
+     * matched by any device of that name, so a name listed twice does not
+     * wait for a second device.
+     *
+     * Once the timeout has passed, the remaining devices are only checked
+     * for being present. A timeout of 0 checks all devices this way
+     * without waiting.
+     *
+     * @param [in] display The X display connection
+     * @param [in] names   The names of the devices to wait for
+     * @param [in] timeout The timeout in milliseconds for all devices
+     *
+     * @return Whether all devices were added
+     */
+    static bool WaitForDevices(::Display *display,
+                               const std::vector<std::string> &names,
+                               time_t timeout = 1000);
+
     /**
      * Wait for an event on the X connection.
      *
@@ -252,6 +359,22 @@ class XServer : public xorg::testing::Process {
      */
     static bool WaitForEventOfType(::Display *display, int type, int extension = -1, int evtype = -1, time_t timeout = 1000);
 
+    /**
+     * Kill all clients connected to the server except the given one.
+     *
+     * Clients are enumerated through the X-Resource extension and killed
+     * with XKillClient(). All resources of the killed clients, including
+     * windows, grabs, selections and event masks, are freed by the server.
+     *
+     * @param [in] display The X display connection that survives
+     *
+     * @throws std::runtime_error if the X-Resource extension is not
+     *         available.
+     *
+     * @return The number of clients killed
+     */
+    static unsigned int KillOtherClients(::Display *display);
+
     /**
      * Install a default XIOErrorHandler. That error handler will throw an
      * xorg::testing::XIOError when encountered.
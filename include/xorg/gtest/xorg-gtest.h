@@ -32,9 +32,17 @@
 #include "xorg-gtest-process.h"
 #include "xorg-gtest-xserver.h"
 #include "xorg-gtest-test.h"
+#include "xorg-gtest-displaycache.h"
+#include "xorg-gtest-deviceproperties.h"
+#include "xorg-gtest-multiclient.h"
+#include "xorg-gtest-xorgconfig.h"
 
 #ifdef HAVE_EVEMU
 #include "evemu/xorg-gtest-device.h"
+#include "evemu/xorg-gtest-gesture.h"
+#include "evemu/xorg-gtest-capabilities.h"
+#include "evemu/xorg-gtest-devicepool.h"
+#include "evemu/xorg-gtest-evdevreader.h"
 #endif
 
 #define XORG_TESTCASE(message) \
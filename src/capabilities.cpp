@@ -0,0 +1,285 @@
+/*******************************************************************************
+ *
+ * X testing environment - snapshot of evemu device capabilities
+ *
+ * Copyright © 2026 xorg-gtest contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ ******************************************************************************/
+
+
+#include "xorg/gtest/evemu/xorg-gtest-capabilities.h"
+
+#include <fcntl.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+
+#include <cstring>
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+
+/* the number of codes of each event type */
+static int code_count(int type) {
+  switch (type) {
+    case EV_SYN: return EV_CNT;
+    case EV_KEY: return KEY_CNT;
+    case EV_REL: return REL_CNT;
+    case EV_ABS: return ABS_CNT;
+    case EV_MSC: return MSC_CNT;
+    case EV_SW: return SW_CNT;
+    case EV_LED: return LED_CNT;
+    case EV_SND: return SND_CNT;
+    case EV_REP: return REP_CNT;
+    case EV_FF: return FF_CNT;
+    default: return 0;
+  }
+}
+
+static bool same_axis(const struct input_absinfo &a,
+                      const struct input_absinfo &b) {
+  return a.minimum == b.minimum && a.maximum == b.maximum &&
+         a.fuzz == b.fuzz && a.flat == b.flat && a.resolution == b.resolution;
+}
+
+static bool valid_event(int type, int code) {
+  return type >= 0 && type < EV_CNT && code >= 0 && code < KEY_CNT;
+}
+
+/* Sets the bits of an evdev bitmask, bit n is bit n % 8 of byte n / 8 */
+static void set_bits(std::bitset<KEY_CNT> *bits, const unsigned char *bytes,
+                     size_t size) {
+  for (size_t i = 0; i < size && i * 8 < KEY_CNT; i++) {
+    if (!bytes[i])
+      continue;
+    for (int bit = 0; bit < 8; bit++)
+      if ((bytes[i] & (1 << bit)) && i * 8 + bit < KEY_CNT)
+        bits->set(i * 8 + bit);
+  }
+}
+
+xorg::testing::evemu::DeviceCapabilities::DeviceCapabilities() {
+  memset(abs_, 0, sizeof(abs_));
+}
+
+xorg::testing::evemu::DeviceCapabilities::DeviceCapabilities(Device &device) {
+  memset(abs_, 0, sizeof(abs_));
+
+  int fd = open(device.GetDeviceNode().c_str(), O_RDONLY | O_NONBLOCK);
+  if (fd == -1)
+    throw std::runtime_error("Failed to open device node");
+
+  /* one EVIOCGBIT per supported type, EVIOCGBIT(0) gives the types */
+  unsigned char bytes[KEY_CNT / 8 + 1];
+  for (int type = 0; type < EV_CNT; type++) {
+    if (type != EV_SYN && !bits_[EV_SYN].test(type))
+      continue;
+
+    int count = code_count(type);
+    if (count == 0)
+      continue;
+
+    memset(bytes, 0, sizeof(bytes));
+    int len = ioctl(fd, EVIOCGBIT(type, (count + 7) / 8), bytes);
+    if (len > 0)
+      set_bits(&bits_[type], bytes, len);
+  }
+
+  for (int code = 0; code < ABS_CNT; code++) {
+    if (!bits_[EV_ABS].test(code))
+      continue;
+
+    if (ioctl(fd, EVIOCGABS(code), &abs_[code]) != 0) {
+      close(fd);
+      throw std::runtime_error("Failed to query absolute axis");
+    }
+    abs_[code].value = 0; /* not a capability */
+  }
+
+  close(fd);
+}
+
+xorg::testing::evemu::DeviceCapabilities::DeviceCapabilities(const DeviceDescriptor &descriptor) {
+  memset(abs_, 0, sizeof(abs_));
+
+  for (int type = 0; type < EV_CNT; type++)
+    set_bits(&bits_[type], descriptor.events[type].bits,
+             descriptor.events[type].size);
+
+  for (unsigned int i = 0; i < descriptor.naxes; i++) {
+    const AbsAxisDescriptor &axis = descriptor.axes[i];
+    if (axis.code >= 0 && axis.code < ABS_CNT && bits_[EV_ABS].test(axis.code))
+      SetAbsData(axis.code, axis.minimum, axis.maximum, axis.fuzz, axis.flat,
+                 axis.resolution);
+  }
+}
+
+void xorg::testing::evemu::DeviceCapabilities::SetEvent(int type, int code) {
+  if (!valid_event(type, code))
+    throw std::runtime_error("Invalid event type or code");
+
+  bits_[type].set(code);
+  bits_[EV_SYN].set(type);
+}
+
+void xorg::testing::evemu::DeviceCapabilities::SetAbsData(int code, int min,
+                                                          int max, int fuzz,
+                                                          int flat,
+                                                          int resolution) {
+  if (code < 0 || code >= ABS_CNT)
+    throw std::runtime_error("Invalid axis code");
+
+  SetEvent(EV_ABS, code);
+  abs_[code].minimum = min;
+  abs_[code].maximum = max;
+  abs_[code].fuzz = fuzz;
+  abs_[code].flat = flat;
+  abs_[code].resolution = resolution;
+}
+
+bool xorg::testing::evemu::DeviceCapabilities::HasEvent(int type, int code) const {
+  return valid_event(type, code) && bits_[type].test(code);
+}
+
+bool xorg::testing::evemu::DeviceCapabilities::GetAbsData(int code, int *min,
+                                                          int *max, int *fuzz,
+                                                          int *flat,
+                                                          int *resolution) const {
+  if (code < 0 || code >= ABS_CNT || !bits_[EV_ABS].test(code))
+    return false;
+
+  *min = abs_[code].minimum;
+  *max = abs_[code].maximum;
+  if (fuzz)
+    *fuzz = abs_[code].fuzz;
+  if (flat)
+    *flat = abs_[code].flat;
+  if (resolution)
+    *resolution = abs_[code].resolution;
+  return true;
+}
+
+const std::bitset<KEY_CNT>&
+xorg::testing::evemu::DeviceCapabilities::GetCodes(int type) const {
+  if (type < 0 || type >= EV_CNT)
+    throw std::runtime_error("Invalid event type");
+  return bits_[type];
+}
+
+int xorg::testing::evemu::DeviceCapabilities::NextCode(int type, int code) const {
+  if (type < 0 || type >= EV_CNT)
+    return -1;
+
+  const std::bitset<KEY_CNT> &bits = bits_[type];
+  if (bits.none())
+    return -1;
+
+  for (int i = code + 1; i < KEY_CNT; i++)
+    if (bits.test(i))
+      return i;
+  return -1;
+}
+
+unsigned int xorg::testing::evemu::DeviceCapabilities::Count(int type) const {
+  if (type < 0 || type >= EV_CNT)
+    return 0;
+  return bits_[type].count();
+}
+
+xorg::testing::evemu::DeviceCapabilities
+xorg::testing::evemu::DeviceCapabilities::operator&(const DeviceCapabilities &other) const {
+  DeviceCapabilities result(*this);
+  for (int type = 0; type < EV_CNT; type++)
+    result.bits_[type] &= other.bits_[type];
+  return result;
+}
+
+xorg::testing::evemu::DeviceCapabilities
+xorg::testing::evemu::DeviceCapabilities::operator|(const DeviceCapabilities &other) const {
+  DeviceCapabilities result(*this);
+  for (int type = 0; type < EV_CNT; type++)
+    result.bits_[type] |= other.bits_[type];
+
+  for (int code = 0; code < ABS_CNT; code++)
+    if (!bits_[EV_ABS].test(code) && other.bits_[EV_ABS].test(code))
+      result.abs_[code] = other.abs_[code];
+
+  return result;
+}
+
+xorg::testing::evemu::DeviceCapabilities
+xorg::testing::evemu::DeviceCapabilities::operator-(const DeviceCapabilities &other) const {
+  DeviceCapabilities result(*this);
+  result.bits_[EV_SYN].set(EV_SYN, bits_[EV_SYN].test(EV_SYN) &&
+                                   !other.bits_[EV_SYN].test(EV_SYN));
+
+  for (int type = 1; type < EV_CNT; type++) {
+    result.bits_[type] &= ~other.bits_[type];
+
+    /* a type stays if the other lacks it or some of its codes */
+    bool keep = bits_[EV_SYN].test(type) &&
+                (!other.bits_[EV_SYN].test(type) || result.bits_[type].any());
+    result.bits_[EV_SYN].set(type, keep);
+  }
+  return result;
+}
+
+bool xorg::testing::evemu::DeviceCapabilities::operator==(const DeviceCapabilities &other) const {
+  for (int type = 0; type < EV_CNT; type++)
+    if (bits_[type] != other.bits_[type])
+      return false;
+
+  for (int code = 0; code < ABS_CNT; code++)
+    if (bits_[EV_ABS].test(code) && !same_axis(abs_[code], other.abs_[code]))
+      return false;
+
+  return true;
+}
+
+bool xorg::testing::evemu::DeviceCapabilities::operator!=(const DeviceCapabilities &other) const {
+  return !(*this == other);
+}
+
+std::ostream& xorg::testing::evemu::operator<<(std::ostream &os,
+                                               const DeviceCapabilities &caps) {
+  std::stringstream s;
+  s << std::hex << std::setfill('0');
+
+  for (int type = 1; type < EV_CNT; type++) {
+    if (caps.Count(type) == 0)
+      continue;
+
+    s << "type 0x" << std::setw(2) << type << ":";
+    for (int code = caps.NextCode(type, -1); code != -1;
+         code = caps.NextCode(type, code)) {
+      s << " 0x" << std::setw(3) << code;
+
+      int min, max, fuzz, flat, resolution;
+      if (type == EV_ABS &&
+          caps.GetAbsData(code, &min, &max, &fuzz, &flat, &resolution))
+        s << std::dec << " [" << min << ".." << max << " fuzz " << fuzz
+          << " flat " << flat << " res " << resolution << "]" << std::hex;
+    }
+    s << "\n";
+  }
+
+  return os << s.str();
+}
@@ -3,6 +3,8 @@
 
 #define DEFAULT_XORG_LOGFILE LOGFILE_DIR "/Xorg.GTest.log"
 #define DEFAULT_DISPLAY 133
+#define DEFAULT_XORG_CONFIG_DIR "/dev/shm"
+#define X11_SOCKET_DIR "/tmp/.X11-unix"
 
 /* Allow user to override default Xorg server*/
 #ifndef DEFAULT_XORG_SERVER
@@ -29,27 +29,76 @@
 #include "xorg/gtest/evemu/xorg-gtest-device.h"
 
 #include <linux/input.h>
+#include <linux/uinput.h>
 #include <fcntl.h>
 #include <dirent.h>
 #include <sys/inotify.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/timerfd.h>
 #include <poll.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <unistd.h>
 
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <set>
 #include <stdexcept>
+#include <vector>
 
 #include <gtest/gtest.h>
 
 #define SYS_INPUT_DIR "/sys/class/input"
+#define SYS_VIRTUAL_INPUT_DIR "/sys/devices/virtual/input/"
 #define DEV_INPUT_DIR "/dev/input/"
 
+#define RECORDING_MAGIC "XGTESTEV"
+#define RECORDING_VERSION 1
+
 struct xorg::testing::evemu::Device::Private {
-  Private() : fd(-1), device(NULL), device_node() {}
+  Private() : fd(-1), descriptor(NULL), device_node(),
+              wait_for_node(true) {
+    queue.reserve(64);
+    memset(&playback_stats, 0, sizeof(playback_stats));
+  }
 
   int fd;
-  struct evemu_device* device;
+  const DeviceDescriptor* descriptor;
   std::string device_node;
+  bool wait_for_node;
   time_t ctime;
+  std::vector<struct input_event> queue;
+  PlaybackStats playback_stats;
+
+  const char* GetName() const {
+    return descriptor->name;
+  }
 };
 
+static uint64_t now_ns() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/* Writes all events at once, uinput handles any number per write */
+static bool write_events(int fd, const struct input_event *events,
+                         size_t count) {
+  size_t len = count * sizeof(*events);
+  ssize_t written;
+
+  do {
+    written = write(fd, events, len);
+  } while (written == -1 && errno == EINTR);
+
+  return written == static_cast<ssize_t>(len);
+}
+
 static int _event_device_compare(const struct dirent **a,
                                  const struct dirent **b) {
   int na, nb;
@@ -99,7 +148,7 @@ void xorg::testing::evemu::Device::GuessDeviceNode(time_t ctime) {
   for (int i = 0; i < n_event_devices && !found; i++) {
     std::stringstream s;
     s << DEV_INPUT_DIR << event_devices[i]->d_name;
-    found = event_is_device(s.str(), evemu_get_name(d_->device), ctime);
+    found = event_is_device(s.str(), d_->GetName(), ctime);
     if (found)
       d_->device_node = s.str();
   }
@@ -112,97 +161,569 @@ void xorg::testing::evemu::Device::GuessDeviceNode(time_t ctime) {
   free(event_devices);
 }
 
-static std::string wait_for_inotify(int fd)
+/* Waits up to timeout ms for event nodes to be created in /dev/input.
+ * Returns all event nodes reported by the first read that had any, or
+ * none if the timeout expired. */
+static std::vector<std::string> wait_for_inotify(int fd, int timeout = 2000)
 {
-  std::string devnode;
-  bool found = false;
+  std::vector<std::string> devnodes;
   struct pollfd pfd;
+  uint64_t deadline = now_ns() + timeout * 1000000ULL;
 
   pfd.fd = fd;
   pfd.events = POLLIN;
 
-  char buf[1024];
-  size_t bufidx = 0;
+  /* reads return whole events, one fits with the longest name */
+  char buf[4096];
 
-  while (!found && poll(&pfd, 1, 2000) > 0) {
-    ssize_t r;
+  while (devnodes.empty()) {
+    /* unrelated nodes must not restart the timeout */
+    uint64_t now = now_ns();
+    if (now >= deadline ||
+        poll(&pfd, 1, (deadline - now + 999999) / 1000000) <= 0)
+      break;
 
-    r = read(fd, buf + bufidx, sizeof(buf) - bufidx);
-    if (r == -1 && errno != EAGAIN) {
+    ssize_t r = read(fd, buf, sizeof(buf));
+    if (r == -1 && errno == EAGAIN)
+      continue;
+    if (r <= 0) {
       std::cerr << "inotify read failed with: " << std::string(strerror(errno)) << std::endl;
       break;
     }
 
-    bufidx += r;
-
-    struct inotify_event *e = reinterpret_cast<struct inotify_event*>(buf);
+    ssize_t len;
+    for (ssize_t pos = 0; pos + static_cast<ssize_t>(sizeof(struct inotify_event)) <= r;
+         pos += len) {
+      struct inotify_event *e = reinterpret_cast<struct inotify_event*>(buf + pos);
+      len = sizeof(*e) + e->len;
+      if (e->len > 0 && strncmp(e->name, "event", 5) == 0)
+        devnodes.push_back(DEV_INPUT_DIR + std::string(e->name));
+    }
+  }
 
-    while (bufidx > sizeof(*e) && bufidx >= sizeof(*e) + e->len) {
-      if (strncmp(e->name, "event", 5) == 0) {
-        devnode = DEV_INPUT_DIR + std::string(e->name);
-        found = true;
-        break;
-      }
+  return devnodes;
+}
 
-      /* this packet didn't contain what we're looking for */
-      int len = sizeof(*e) + e->len;
-      memmove(buf, buf + len, bufidx - len);
-      bufidx -= len;
-    }
+static int watch_dev_input() {
+  int ifd = inotify_init1(IN_NONBLOCK);
+  if (ifd == -1 || inotify_add_watch(ifd, DEV_INPUT_DIR, IN_CREATE) == -1) {
+    std::cerr << "Failed to create inotify watch" << std::endl;
+    if (ifd != -1)
+      close(ifd);
+    ifd = -1;
   }
+  return ifd;
+}
+
+#ifdef UI_GET_SYSNAME
+/* Looks up the event node of the uinput device behind fd in sysfs. Returns
+ * an empty string if the kernel does not support UI_GET_SYSNAME */
+static std::string sysname_to_devnode(int fd) {
+  char sysname[64];
+  if (ioctl(fd, UI_GET_SYSNAME(sizeof(sysname)), sysname) < 0)
+    return "";
+
+  struct dirent **entries = NULL;
+  std::string dir = SYS_VIRTUAL_INPUT_DIR + std::string(sysname);
+  int n_entries = scandir(dir.c_str(), &entries, _event_device_filter,
+                          _event_device_compare);
+
+  std::string devnode;
+  if (n_entries > 0)
+    devnode = DEV_INPUT_DIR + std::string(entries[0]->d_name);
+
+  for (int i = 0; i < n_entries; i++)
+    free(entries[i]);
+  free(entries);
 
   return devnode;
 }
 
-xorg::testing::evemu::Device::Device(const std::string& path)
-    : d_(new Private) {
-  static const char UINPUT_NODE[] = "/dev/uinput";
+/* The sysfs entry exists once the device is created, the device node may
+ * still be on its way */
+static bool wait_for_device_node(const std::string &devnode) {
+  if (access(devnode.c_str(), F_OK) == 0)
+    return true;
+
+  int ifd = watch_dev_input();
+  if (ifd == -1)
+    return false;
 
-  d_->device = evemu_new(NULL);
-  if (!d_->device)
-    throw std::runtime_error("Failed to create evemu record");
+  uint64_t deadline = now_ns() + 2000000000ULL;
+  uint64_t now;
+  bool found = (access(devnode.c_str(), F_OK) == 0);
+  while (!found && (now = now_ns()) < deadline) {
+    std::vector<std::string> devnodes =
+      wait_for_inotify(ifd, (deadline - now + 999999) / 1000000);
+    if (devnodes.empty())
+      break;
+    found = (std::find(devnodes.begin(), devnodes.end(), devnode) != devnodes.end());
+  }
+  close(ifd);
+
+  return found;
+}
+#endif
+
+struct DescriptionCacheEntry {
+  struct timespec mtime;
+  off_t size;
+  std::string text;
+};
+
+static pthread_mutex_t description_cache_mutex = PTHREAD_MUTEX_INITIALIZER;
+static std::map<std::string, DescriptionCacheEntry> description_cache;
+
+xorg::testing::evemu::DeviceDescription::DeviceDescription(const std::string& text)
+  : text_(text) {
+}
+
+xorg::testing::evemu::DeviceDescription
+xorg::testing::evemu::DeviceDescription::FromFile(const std::string& path) {
+  struct stat st;
+  if (stat(path.c_str(), &st) != 0)
+    throw std::runtime_error("Failed to open device file");
+
+  pthread_mutex_lock(&description_cache_mutex);
+  std::map<std::string, DescriptionCacheEntry>::iterator it =
+    description_cache.find(path);
+  if (it != description_cache.end() &&
+      it->second.mtime.tv_sec == st.st_mtim.tv_sec &&
+      it->second.mtime.tv_nsec == st.st_mtim.tv_nsec &&
+      it->second.size == st.st_size) {
+    DeviceDescription description(it->second.text);
+    pthread_mutex_unlock(&description_cache_mutex);
+    return description;
+  }
+  pthread_mutex_unlock(&description_cache_mutex);
 
   FILE* fp = fopen(path.c_str(), "r");
-  if (fp == NULL) {
-    evemu_delete(d_->device);
+  if (fp == NULL)
     throw std::runtime_error("Failed to open device file");
+
+  std::string text;
+  char buf[4096];
+  size_t len;
+  while ((len = fread(buf, 1, sizeof(buf), fp)) > 0)
+    text.append(buf, len);
+  fclose(fp);
+
+  DescriptionCacheEntry entry;
+  entry.mtime = st.st_mtim;
+  entry.size = st.st_size;
+  entry.text = text;
+
+  pthread_mutex_lock(&description_cache_mutex);
+  description_cache[path] = entry;
+  pthread_mutex_unlock(&description_cache_mutex);
+
+  return DeviceDescription(text);
+}
+
+const std::string& xorg::testing::evemu::DeviceDescription::GetText() const {
+  return text_;
+}
+
+bool xorg::testing::evemu::DeviceDescriptor::HasEvent(int type, int code) const {
+  if (type < 0 || type >= EV_CNT || code < 0 ||
+      static_cast<unsigned int>(code) >= events[type].size * 8)
+    return false;
+  return events[type].bits[code / 8] & (1 << (code % 8));
+}
+
+const xorg::testing::evemu::AbsAxisDescriptor*
+xorg::testing::evemu::DeviceDescriptor::GetAbsAxis(int code) const {
+  for (unsigned int i = 0; i < naxes; i++)
+    if (axes[i].code == code)
+      return &axes[i];
+  return NULL;
+}
+
+/* A DeviceDescriptor parsed from a description at runtime, owning the
+ * memory the descriptor points to */
+struct ParsedDescriptor {
+  xorg::testing::evemu::DeviceDescriptor descriptor;
+  std::string name;
+  std::vector<unsigned char> props;
+  std::vector<unsigned char> bits[EV_CNT];
+  std::vector<xorg::testing::evemu::AbsAxisDescriptor> axes;
+};
+
+static void append_hex_bytes(const char *s, std::vector<unsigned char> *bytes) {
+  char *end;
+  for (;;) {
+    unsigned long byte = strtoul(s, &end, 16);
+    if (end == s)
+      break;
+    bytes->push_back(byte);
+    s = end;
   }
+}
 
-  if (evemu_read(d_->device, fp) <= 0) {
-    fclose(fp);
-    evemu_delete(d_->device);
-    throw std::runtime_error("Failed to read device file");
+/* Parses the N:, I:, P:, B: and A: lines of an evemu device property file
+ * the way evemu_read() does, other lines are ignored */
+static ParsedDescriptor* parse_descriptor(const std::string &text) {
+  std::auto_ptr<ParsedDescriptor> parsed(new ParsedDescriptor);
+  xorg::testing::evemu::DeviceDescriptor &desc = parsed->descriptor;
+  memset(&desc, 0, sizeof(desc));
+  bool have_name = false, have_id = false;
+
+  size_t pos = 0;
+  while (pos < text.size()) {
+    size_t eol = text.find('\n', pos);
+    if (eol == std::string::npos)
+      eol = text.size();
+    std::string line = text.substr(pos, eol - pos);
+    pos = eol + 1;
+
+    if (line.compare(0, 3, "N: ") == 0) {
+      parsed->name = line.substr(3);
+      have_name = true;
+    } else if (line.compare(0, 3, "I: ") == 0) {
+      unsigned int bustype, vendor, product, version;
+      if (sscanf(line.c_str() + 3, "%x %x %x %x", &bustype, &vendor,
+                 &product, &version) != 4)
+        return NULL;
+      desc.bustype = bustype;
+      desc.vendor = vendor;
+      desc.product = product;
+      desc.version = version;
+      have_id = true;
+    } else if (line.compare(0, 3, "P: ") == 0) {
+      append_hex_bytes(line.c_str() + 3, &parsed->props);
+    } else if (line.compare(0, 3, "B: ") == 0) {
+      char *end;
+      unsigned long type = strtoul(line.c_str() + 3, &end, 16);
+      if (end == line.c_str() + 3 || type >= EV_CNT)
+        return NULL;
+      append_hex_bytes(end, &parsed->bits[type]);
+    } else if (line.compare(0, 3, "A: ") == 0) {
+      xorg::testing::evemu::AbsAxisDescriptor axis;
+      unsigned int code;
+      axis.resolution = 0;
+      if (sscanf(line.c_str() + 3, "%x %d %d %d %d %d", &code,
+                 &axis.minimum, &axis.maximum, &axis.fuzz, &axis.flat,
+                 &axis.resolution) < 5)
+        return NULL;
+      axis.code = code;
+      parsed->axes.push_back(axis);
+    }
   }
 
-  fclose(fp);
+  if (!have_name || !have_id)
+    return NULL;
 
-  int ifd = inotify_init1(IN_NONBLOCK);
-  if (ifd == -1 || inotify_add_watch(ifd, DEV_INPUT_DIR, IN_CREATE) == -1) {
-    std::cerr << "Failed to create inotify watch" << std::endl;
-    if (ifd != -1)
-      close(ifd);
-    ifd = -1;
+  desc.name = parsed->name.c_str();
+  desc.props.bits = parsed->props.empty() ? NULL : &parsed->props[0];
+  desc.props.size = parsed->props.size();
+  for (int type = 0; type < EV_CNT; type++) {
+    desc.events[type].bits = parsed->bits[type].empty() ? NULL : &parsed->bits[type][0];
+    desc.events[type].size = parsed->bits[type].size();
+  }
+  desc.axes = parsed->axes.empty() ? NULL : &parsed->axes[0];
+  desc.naxes = parsed->axes.size();
+
+  return parsed.release();
+}
+
+/* Descriptors parsed from descriptions, keyed by the text. Like the
+ * generated descriptors they live as long as the process, so devices
+ * created from the same description parse it once. */
+static pthread_mutex_t descriptor_cache_mutex = PTHREAD_MUTEX_INITIALIZER;
+static std::map<std::string, ParsedDescriptor*> descriptor_cache;
+
+static const xorg::testing::evemu::DeviceDescriptor*
+cached_descriptor(const std::string &text) {
+  pthread_mutex_lock(&descriptor_cache_mutex);
+  std::map<std::string, ParsedDescriptor*>::iterator it =
+    descriptor_cache.find(text);
+  ParsedDescriptor *parsed = (it != descriptor_cache.end()) ? it->second : NULL;
+  pthread_mutex_unlock(&descriptor_cache_mutex);
+  if (parsed)
+    return &parsed->descriptor;
+
+  parsed = parse_descriptor(text);
+  if (!parsed)
+    return NULL;
+
+  pthread_mutex_lock(&descriptor_cache_mutex);
+  it = descriptor_cache.find(text);
+  if (it == descriptor_cache.end()) {
+    descriptor_cache[text] = parsed;
+  } else {
+    /* another thread parsed it meanwhile */
+    delete parsed;
+    parsed = it->second;
   }
+  pthread_mutex_unlock(&descriptor_cache_mutex);
+
+  return &parsed->descriptor;
+}
+
+static unsigned long ui_set_bit_request(int type) {
+  switch (type) {
+    case EV_KEY: return UI_SET_KEYBIT;
+    case EV_REL: return UI_SET_RELBIT;
+    case EV_ABS: return UI_SET_ABSBIT;
+    case EV_MSC: return UI_SET_MSCBIT;
+    case EV_LED: return UI_SET_LEDBIT;
+    case EV_SND: return UI_SET_SNDBIT;
+    case EV_FF: return UI_SET_FFBIT;
+    case EV_SW: return UI_SET_SWBIT;
+    default: return 0;
+  }
+}
+
+/* What evemu_create() does, from a descriptor instead of a parsed file */
+static int create_from_descriptor(const xorg::testing::evemu::DeviceDescriptor &desc,
+                                  int fd) {
+  for (int type = 0; type < EV_CNT; type++) {
+    if (!desc.HasEvent(EV_SYN, type))
+      continue;
+
+    if (ioctl(fd, UI_SET_EVBIT, type) < 0)
+      return -1;
+
+    unsigned long request = ui_set_bit_request(type);
+    if (!request)
+      continue;
+
+    for (unsigned int code = 0; code < desc.events[type].size * 8; code++)
+      if (desc.HasEvent(type, code) && ioctl(fd, request, code) < 0)
+        return -1;
+  }
+
+#ifdef UI_SET_PROPBIT
+  for (unsigned int prop = 0; prop < desc.props.size * 8; prop++)
+    if ((desc.props.bits[prop / 8] & (1 << (prop % 8))) &&
+        ioctl(fd, UI_SET_PROPBIT, prop) < 0)
+      return -1;
+#endif
+
+  struct uinput_user_dev udev;
+  memset(&udev, 0, sizeof(udev));
+  strncpy(udev.name, desc.name, UINPUT_MAX_NAME_SIZE - 1);
+  udev.id.bustype = desc.bustype;
+  udev.id.vendor = desc.vendor;
+  udev.id.product = desc.product;
+  udev.id.version = desc.version;
+
+  for (unsigned int i = 0; i < desc.naxes; i++) {
+    const xorg::testing::evemu::AbsAxisDescriptor &axis = desc.axes[i];
+    if (axis.code < 0 || axis.code >= ABS_CNT)
+      continue;
+    udev.absmin[axis.code] = axis.minimum;
+    udev.absmax[axis.code] = axis.maximum;
+    udev.absfuzz[axis.code] = axis.fuzz;
+    udev.absflat[axis.code] = axis.flat;
+  }
+
+  if (write(fd, &udev, sizeof(udev)) != sizeof(udev))
+    return -1;
+
+  return ioctl(fd, UI_DEV_CREATE);
+}
+
+xorg::testing::evemu::Device::Device(const std::string& path)
+    : d_(new Private) {
+  Create(DeviceDescription::FromFile(path));
+}
+
+xorg::testing::evemu::Device::Device(const DeviceDescription& description)
+    : d_(new Private) {
+  Create(description);
+}
+
+xorg::testing::evemu::Device::Device(const DeviceDescriptor& descriptor)
+    : d_(new Private) {
+  d_->descriptor = &descriptor;
+  CreateUinputDevice();
+}
+
+xorg::testing::evemu::Device::Device(const DeviceDescription& description,
+                                     bool wait_for_node)
+    : d_(new Private) {
+  d_->wait_for_node = wait_for_node;
+  Create(description);
+}
+
+void xorg::testing::evemu::Device::Create(const DeviceDescription& description) {
+  /* evemu can't copy a parsed device, so descriptions are parsed into a
+   * descriptor once and created like the generated ones */
+  d_->descriptor = cached_descriptor(description.GetText());
+  if (!d_->descriptor)
+    throw std::runtime_error("Failed to read device file");
+
+  CreateUinputDevice();
+}
+
+void xorg::testing::evemu::Device::CreateUinputDevice() {
+  static const char UINPUT_NODE[] = "/dev/uinput";
+
+#ifndef UI_GET_SYSNAME
+  int ifd = d_->wait_for_node ? watch_dev_input() : -1;
+#endif
 
   d_->fd = open(UINPUT_NODE, O_WRONLY);
   if (d_->fd < 0) {
-    evemu_delete(d_->device);
+#ifndef UI_GET_SYSNAME
+    if (ifd != -1)
+      close(ifd);
+#endif
     throw std::runtime_error("Failed to open uinput node");
   }
 
   d_->ctime = time(NULL);
-  if (evemu_create(d_->device, d_->fd) < 0) {
+  if (create_from_descriptor(*d_->descriptor, d_->fd) < 0) {
+#ifndef UI_GET_SYSNAME
+    if (ifd != -1)
+      close(ifd);
+#endif
     close(d_->fd);
-    evemu_delete(d_->device);
     throw std::runtime_error("Failed to create evemu device");
   }
 
+#ifdef UI_GET_SYSNAME
+  std::string devnode = sysname_to_devnode(d_->fd);
+  if (!d_->wait_for_node)
+    d_->device_node = devnode; /* CreateMany() waits for the node */
+  else if (!devnode.empty() && wait_for_device_node(devnode))
+    d_->device_node = devnode;
+  /* else kernel older than 3.15, guess node when we'll need it */
+#else
   if (ifd != -1) {
-    std::string devnode = wait_for_inotify(ifd);
-    if (event_is_device(devnode, evemu_get_name(d_->device), d_->ctime))
-        d_->device_node = devnode;
+    /* nodes of other devices may show up in the same read, or first */
+    uint64_t deadline = now_ns() + 2000000000ULL;
+    uint64_t now;
+    while (d_->device_node.empty() && (now = now_ns()) < deadline) {
+      std::vector<std::string> devnodes =
+        wait_for_inotify(ifd, (deadline - now + 999999) / 1000000);
+      if (devnodes.empty())
+        break;
+      for (size_t i = 0; i < devnodes.size() && d_->device_node.empty(); i++)
+        if (event_is_device(devnodes[i], d_->GetName(), d_->ctime))
+          d_->device_node = devnodes[i];
+    }
     close(ifd);
   } /* else guess node when we'll need it */
+#endif
+}
+
+struct CreateManyJob {
+  const xorg::testing::evemu::DeviceDescription *description;
+  xorg::testing::evemu::Device *device;
+  std::string error;
+};
+
+void* xorg::testing::evemu::Device::CreateThread(void *data) {
+  CreateManyJob *job = static_cast<CreateManyJob*>(data);
+
+  try {
+    job->device = new Device(*job->description, false);
+  } catch (std::runtime_error &e) {
+    job->error = e.what();
+  }
+
+  return NULL;
+}
+
+std::vector<xorg::testing::evemu::Device*>
+xorg::testing::evemu::Device::CreateMany(const std::vector<DeviceDescription>& descriptions) {
+  size_t n = descriptions.size();
+  std::vector<CreateManyJob> jobs(n);
+  std::vector<pthread_t> threads(n);
+  std::vector<bool> started(n);
+
+  /* one watch for all devices, set up before any of them exists */
+  int ifd = watch_dev_input();
+
+  for (size_t i = 0; i < n; i++) {
+    jobs[i].description = &descriptions[i];
+    jobs[i].device = NULL;
+    started[i] = (pthread_create(&threads[i], NULL, CreateThread, &jobs[i]) == 0);
+    if (!started[i])
+      CreateThread(&jobs[i]);
+  }
+
+  for (size_t i = 0; i < n; i++)
+    if (started[i])
+      pthread_join(threads[i], NULL);
+
+  std::vector<Device*> devices;
+  std::string error;
+  for (size_t i = 0; i < n; i++) {
+    if (jobs[i].device)
+      devices.push_back(jobs[i].device);
+    else if (error.empty())
+      error = jobs[i].error;
+  }
+
+  if (!error.empty()) {
+    for (size_t i = 0; i < devices.size(); i++)
+      delete devices[i];
+    if (ifd != -1)
+      close(ifd);
+    throw std::runtime_error(error);
+  }
+
+  uint64_t deadline = now_ns() + 2000000000ULL;
+  uint64_t now;
+
+#ifdef UI_GET_SYSNAME
+  std::set<std::string> pending;
+  for (size_t i = 0; i < n; i++)
+    if (!devices[i]->d_->device_node.empty())
+      pending.insert(devices[i]->d_->device_node);
+
+  /* check all pending nodes whenever some node shows up */
+  while (true) {
+    std::set<std::string>::iterator it = pending.begin();
+    while (it != pending.end()) {
+      if (access(it->c_str(), F_OK) == 0)
+        pending.erase(it++);
+      else
+        it++;
+    }
+
+    now = now_ns();
+    if (pending.empty() || ifd == -1 || now >= deadline ||
+        wait_for_inotify(ifd, (deadline - now + 999999) / 1000000).empty())
+      break;
+  }
+
+  /* guess nodes that did not show up when we'll need them */
+  for (size_t i = 0; i < n; i++)
+    if (pending.count(devices[i]->d_->device_node))
+      devices[i]->d_->device_node.clear();
+#else
+  /* nodes are matched by name and creation time, nodes of other devices
+   * are skipped. Devices created from the same description may swap nodes
+   * but are interchangeable. */
+  size_t unmatched = n;
+  while (ifd != -1 && unmatched > 0 && (now = now_ns()) < deadline) {
+    std::vector<std::string> devnodes =
+      wait_for_inotify(ifd, (deadline - now + 999999) / 1000000);
+    if (devnodes.empty())
+      break;
+
+    for (size_t j = 0; j < devnodes.size(); j++) {
+      for (size_t i = 0; i < n; i++) {
+        Private *d = devices[i]->d_.get();
+        if (d->device_node.empty() &&
+            event_is_device(devnodes[j], d->GetName(), d->ctime)) {
+          d->device_node = devnodes[j];
+          unmatched--;
+          break;
+        }
+      }
+    }
+  }
+#endif
+
+  if (ifd != -1)
+    close(ifd);
+
+  return devices;
 }
 
 void xorg::testing::evemu::Device::Play(const std::string& path) const {
@@ -218,6 +739,352 @@ void xorg::testing::evemu::Device::Play(const std::string& path) const {
   fclose(file);
 }
 
+/* Compiled recordings are a local cache, so events are stored in the native
+ * input_event layout and frames are written straight from the mapping.
+ * The header is followed by nframes + 1 offsets, the index of the first
+ * event of each frame and the total number of events, padded to 8 bytes,
+ * followed by the events. */
+struct RecordingHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t event_size;
+  uint64_t source_hash;
+  uint32_t nframes;
+  uint32_t nevents;
+};
+
+static size_t recording_events_offset(uint32_t nframes) {
+  size_t offsets_size = (static_cast<size_t>(nframes) + 1) * sizeof(uint32_t);
+  return sizeof(RecordingHeader) + ((offsets_size + 7) & ~7);
+}
+
+/* FNV-1a over the file contents */
+static bool hash_file(const std::string &path, uint64_t *hash) {
+  FILE *fp = fopen(path.c_str(), "r");
+  if (!fp)
+    return false;
+
+  uint64_t h = 14695981039346656037ULL;
+  unsigned char buf[8192];
+  size_t len;
+
+  while ((len = fread(buf, 1, sizeof(buf), fp)) > 0)
+    for (size_t i = 0; i < len; i++)
+      h = (h ^ buf[i]) * 1099511628211ULL;
+
+  bool success = !ferror(fp);
+  fclose(fp);
+
+  *hash = h;
+  return success;
+}
+
+/* Checks the header and the frame offsets of a mapped compiled recording,
+ * every frame must be a non-empty range within the events */
+static bool recording_is_valid(const void *data, size_t size, uint64_t hash) {
+  const RecordingHeader *header = static_cast<const RecordingHeader*>(data);
+
+  if (size < sizeof(*header) ||
+      memcmp(header->magic, RECORDING_MAGIC, sizeof(header->magic)) != 0 ||
+      header->version != RECORDING_VERSION ||
+      header->event_size != sizeof(struct input_event) ||
+      header->source_hash != hash ||
+      size != recording_events_offset(header->nframes) +
+              static_cast<size_t>(header->nevents) * sizeof(struct input_event))
+    return false;
+
+  const uint32_t *offsets = reinterpret_cast<const uint32_t*>(header + 1);
+  if (offsets[0] != 0 || offsets[header->nframes] != header->nevents)
+    return false;
+
+  for (uint32_t i = 0; i < header->nframes; i++)
+    if (offsets[i] >= offsets[i + 1])
+      return false;
+
+  return true;
+}
+
+/* The cache directory for compiled recordings. Unless set through
+ * XORG_GTEST_RECORDING_CACHE, this is a directory private to the user, so
+ * other users cannot plant recordings for us to play. */
+static std::string recording_cache_dir() {
+  const char *cache_dir = getenv("XORG_GTEST_RECORDING_CACHE");
+  if (cache_dir && *cache_dir)
+    return cache_dir;
+
+  std::string dir;
+  const char *xdg_cache = getenv("XDG_CACHE_HOME");
+  const char *home = getenv("HOME");
+  if (xdg_cache && *xdg_cache) {
+    dir = std::string(xdg_cache) + "/xorg-gtest";
+  } else if (home && *home) {
+    dir = std::string(home) + "/.cache/xorg-gtest";
+  } else {
+    char name[64];
+    snprintf(name, sizeof(name), "/tmp/xorg-gtest-%u",
+             static_cast<unsigned int>(geteuid()));
+    dir = name;
+  }
+
+  if (mkdir(dir.c_str(), 0700) != 0 && errno != EEXIST)
+    throw std::runtime_error("Failed to create recording cache " + dir);
+
+  struct stat st;
+  if (lstat(dir.c_str(), &st) != 0 || !S_ISDIR(st.st_mode) ||
+      st.st_uid != geteuid() || (st.st_mode & 077) != 0)
+    throw std::runtime_error("Recording cache " + dir +
+                             " is not a directory private to the user");
+
+  return dir;
+}
+
+static std::string compiled_recording_path(const std::string &path,
+                                           uint64_t *hash) {
+  if (!hash_file(path, hash))
+    throw std::runtime_error("Failed to read recording file");
+
+  char name[64];
+  snprintf(name, sizeof(name), "/xorg-gtest-recording-%016llx.bin",
+           static_cast<unsigned long long>(*hash));
+  return recording_cache_dir() + name;
+}
+
+/* Maps a compiled recording if it is a regular file of the user that no
+ * one else can write to and it is valid for the given hash. The file
+ * checked is the one mapped, so it cannot be swapped in between. */
+static bool map_compiled_recording(const std::string &compiled, uint64_t hash,
+                                   void **map, size_t *size) {
+  int fd = open(compiled.c_str(), O_RDONLY | O_NOFOLLOW);
+  if (fd == -1)
+    return false;
+
+  struct stat st;
+  if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) ||
+      st.st_uid != geteuid() || (st.st_mode & 022) != 0 ||
+      st.st_size < static_cast<off_t>(sizeof(RecordingHeader))) {
+    close(fd);
+    return false;
+  }
+
+  void *data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (data == MAP_FAILED)
+    return false;
+
+  if (!recording_is_valid(data, st.st_size, hash)) {
+    munmap(data, st.st_size);
+    return false;
+  }
+
+  *map = data;
+  *size = st.st_size;
+  return true;
+}
+
+static void compile_recording(const std::string &path, uint64_t hash,
+                              const std::string &compiled) {
+  FILE *fp = fopen(path.c_str(), "r");
+  if (!fp)
+    throw std::runtime_error("Failed to open recording file");
+
+  std::vector<struct input_event> events;
+  std::vector<uint32_t> offsets;
+  struct input_event ev;
+  bool frame_start = true;
+
+  while (evemu_read_event(fp, &ev) > 0) {
+    if (frame_start)
+      offsets.push_back(events.size());
+    events.push_back(ev);
+    frame_start = (ev.type == EV_SYN && ev.code == SYN_REPORT);
+  }
+  fclose(fp);
+
+  RecordingHeader header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, RECORDING_MAGIC, sizeof(header.magic));
+  header.version = RECORDING_VERSION;
+  header.event_size = sizeof(struct input_event);
+  header.source_hash = hash;
+  header.nframes = offsets.size();
+  header.nevents = events.size();
+  offsets.push_back(events.size());
+
+  std::vector<char> data(recording_events_offset(header.nframes) +
+                         events.size() * sizeof(struct input_event));
+  memcpy(&data[0], &header, sizeof(header));
+  memcpy(&data[sizeof(header)], &offsets[0], offsets.size() * sizeof(uint32_t));
+  if (!events.empty())
+    memcpy(&data[recording_events_offset(header.nframes)], &events[0],
+           events.size() * sizeof(struct input_event));
+
+  /* write to a temporary file first, concurrent tests may compile the
+   * same recording */
+  std::string tmpname = compiled + ".XXXXXX";
+  std::vector<char> tmpl(tmpname.begin(), tmpname.end());
+  tmpl.push_back('\0');
+
+  int fd = mkstemp(&tmpl[0]);
+  if (fd == -1)
+    throw std::runtime_error("Failed to create compiled recording");
+
+  bool success = (write(fd, &data[0], data.size()) ==
+                  static_cast<ssize_t>(data.size()));
+  close(fd);
+
+  if (!success || rename(&tmpl[0], compiled.c_str()) != 0) {
+    unlink(&tmpl[0]);
+    throw std::runtime_error("Failed to write compiled recording");
+  }
+}
+
+std::string xorg::testing::evemu::Device::CompileRecording(const std::string& path) {
+  uint64_t hash;
+  std::string compiled = compiled_recording_path(path, &hash);
+
+  void *map;
+  size_t size;
+  if (map_compiled_recording(compiled, hash, &map, &size))
+    munmap(map, size);
+  else
+    compile_recording(path, hash, compiled);
+
+  return compiled;
+}
+
+static void wait_for_timer(int tfd, uint64_t target_ns) {
+  struct itimerspec its;
+  memset(&its, 0, sizeof(its));
+  its.it_value.tv_sec = target_ns / 1000000000ULL;
+  its.it_value.tv_nsec = target_ns % 1000000000ULL;
+
+  if (timerfd_settime(tfd, TFD_TIMER_ABSTIME, &its, NULL) != 0)
+    throw std::runtime_error("Failed to arm playback timer");
+
+  uint64_t expirations;
+  while (read(tfd, &expirations, sizeof(expirations)) == -1 && errno == EINTR)
+    ;
+}
+
+static xorg::testing::evemu::Device::PlaybackStats
+play_frames(int fd, const struct input_event *events, const uint32_t *offsets,
+            uint32_t nframes, xorg::testing::evemu::Device::PlaybackMode mode,
+            double factor) {
+  using xorg::testing::evemu::Device;
+
+  if (mode != Device::PLAYBACK_SCALED)
+    factor = 1.0;
+
+  Device::PlaybackStats stats;
+  memset(&stats, 0, sizeof(stats));
+
+  int tfd = -1;
+  if (mode != Device::PLAYBACK_FAST) {
+    tfd = timerfd_create(CLOCK_MONOTONIC, 0);
+    if (tfd == -1)
+      throw std::runtime_error("Failed to create playback timer");
+  }
+
+  uint64_t start = now_ns();
+  double total_jitter_ns = 0;
+  bool success = true;
+
+  for (uint32_t i = 0; success && i < nframes; i++) {
+    const struct input_event *frame = &events[offsets[i]];
+
+    if (tfd != -1) {
+      struct timeval offset;
+      timersub(&frame->time, &events[0].time, &offset);
+      double offset_ns = (offset.tv_sec * 1000000.0 + offset.tv_usec) * 1000.0;
+      uint64_t target = start + static_cast<uint64_t>(offset_ns / factor);
+
+      try {
+        wait_for_timer(tfd, target);
+      } catch (std::runtime_error &e) {
+        close(tfd);
+        throw;
+      }
+
+      double jitter_ns = static_cast<double>(now_ns() - target);
+      total_jitter_ns += jitter_ns;
+      if (jitter_ns / 1000.0 > stats.max_jitter_us)
+        stats.max_jitter_us = jitter_ns / 1000.0;
+      stats.target_ms = offset_ns / factor / 1000000.0;
+    }
+
+    success = write_events(fd, frame, offsets[i + 1] - offsets[i]);
+    if (success)
+      stats.frames++;
+  }
+
+  stats.actual_ms = (now_ns() - start) / 1000000.0;
+  if (tfd != -1 && stats.frames > 0)
+    stats.mean_jitter_us = total_jitter_ns / stats.frames / 1000.0;
+
+  if (tfd != -1)
+    close(tfd);
+
+  if (!success)
+    throw std::runtime_error("Failed to play frames");
+
+  return stats;
+}
+
+void xorg::testing::evemu::Device::PlayFrames(const struct input_event *events,
+                                              const uint32_t *offsets,
+                                              uint32_t nframes,
+                                              PlaybackMode mode,
+                                              double factor) const {
+  if (mode == PLAYBACK_SCALED && factor <= 0)
+    throw std::runtime_error("Playback speed factor must be positive");
+
+  d_->playback_stats = play_frames(d_->fd, events, offsets, nframes, mode,
+                                   factor);
+}
+
+void xorg::testing::evemu::Device::Play(const std::string& path,
+                                        PlaybackMode mode,
+                                        double factor) const {
+  PlayCompiled(path, mode, factor);
+}
+
+void xorg::testing::evemu::Device::PlayCompiled(const std::string& path,
+                                                PlaybackMode mode,
+                                                double factor) const {
+  if (mode == PLAYBACK_SCALED && factor <= 0)
+    throw std::runtime_error("Playback speed factor must be positive");
+
+  uint64_t hash;
+  std::string compiled = compiled_recording_path(path, &hash);
+
+  void *map;
+  size_t size;
+  if (!map_compiled_recording(compiled, hash, &map, &size)) {
+    compile_recording(path, hash, compiled);
+    if (!map_compiled_recording(compiled, hash, &map, &size))
+      throw std::runtime_error("Failed to map compiled recording");
+  }
+
+  const RecordingHeader *header = static_cast<const RecordingHeader*>(map);
+  const uint32_t *offsets = reinterpret_cast<const uint32_t*>(header + 1);
+  const struct input_event *events = reinterpret_cast<const struct input_event*>(
+      static_cast<const char*>(map) + recording_events_offset(header->nframes));
+
+  try {
+    PlayFrames(events, offsets, header->nframes, mode, factor);
+  } catch (std::runtime_error &e) {
+    munmap(map, size);
+    throw;
+  }
+
+  munmap(map, size);
+}
+
+xorg::testing::evemu::Device::PlaybackStats
+xorg::testing::evemu::Device::GetPlaybackStats() const {
+  return d_->playback_stats;
+}
+
 void xorg::testing::evemu::Device::PlayOne(int type, int code, int value, bool sync)
 {
   struct input_event ev;
@@ -236,9 +1103,36 @@ void xorg::testing::evemu::Device::PlayOne(int type, int code, int value, bool s
   }
 }
 
+void xorg::testing::evemu::Device::QueueEvent(int type, int code, int value)
+{
+  struct input_event ev;
+  memset(&ev, 0, sizeof(ev));
+  ev.type = type;
+  ev.code = code;
+  ev.value = value;
+  d_->queue.push_back(ev);
+}
+
+void xorg::testing::evemu::Device::EndFrame()
+{
+  QueueEvent(EV_SYN, SYN_REPORT, 0);
+}
+
+void xorg::testing::evemu::Device::Flush()
+{
+  if (d_->queue.empty())
+    return;
+
+  bool success = write_events(d_->fd, &d_->queue[0], d_->queue.size());
+  d_->queue.clear();
+
+  if (!success)
+    throw std::runtime_error("Failed to write queued events");
+}
+
 bool xorg::testing::evemu::Device::HasEvent(int type, int code)
 {
-    return evemu_has_event(d_->device, type, code);
+    return d_->descriptor->HasEvent(type, code);
 }
 
 bool xorg::testing::evemu::Device::GetAbsData(int code, int *min, int *max, int *fuzz, int *flat, int *resolution)
@@ -246,14 +1140,17 @@ bool xorg::testing::evemu::Device::GetAbsData(int code, int *min, int *max, int
     if (!HasEvent(EV_ABS, code))
         return false;
 
-    *min = evemu_get_abs_minimum(d_->device, code);
-    *max = evemu_get_abs_maximum(d_->device, code);
+    const AbsAxisDescriptor *axis = d_->descriptor->GetAbsAxis(code);
+    if (!axis)
+        return false;
+    *min = axis->minimum;
+    *max = axis->maximum;
     if (fuzz)
-        *fuzz = evemu_get_abs_fuzz(d_->device, code);
+        *fuzz = axis->fuzz;
     if (flat)
-        *flat = evemu_get_abs_flat(d_->device, code);
+        *flat = axis->flat;
     if (resolution)
-        *resolution = evemu_get_abs_resolution(d_->device, code);
+        *resolution = axis->resolution;
     return true;
 }
 
@@ -265,5 +1162,4 @@ const std::string& xorg::testing::evemu::Device::GetDeviceNode(void) {
 
 xorg::testing::evemu::Device::~Device() {
   close(d_->fd);
-  evemu_delete(d_->device);
 }
@@ -0,0 +1,253 @@
+/*******************************************************************************
+ *
+ * X testing environment - pool of reusable evemu devices
+ *
+ * Copyright © 2026 xorg-gtest contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ ******************************************************************************/
+
+
+#include "xorg/gtest/evemu/xorg-gtest-devicepool.h"
+#include "xorg/gtest/evemu/xorg-gtest-capabilities.h"
+#include "xorg/gtest/xorg-gtest-deviceproperties.h"
+
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <map>
+#include <stdexcept>
+#include <vector>
+
+#include <X11/extensions/XInput2.h>
+
+struct PoolEntry {
+  xorg::testing::evemu::Device *device;
+  xorg::testing::evemu::DeviceCapabilities capabilities;
+  bool leased;
+  int x_deviceid;
+  std::string x_display;
+};
+
+static pthread_mutex_t device_pool_mutex = PTHREAD_MUTEX_INITIALIZER;
+static std::map<std::string, std::vector<PoolEntry*> > device_pool;
+
+struct xorg::testing::evemu::DeviceLease::Private {
+  PoolEntry *entry;
+};
+
+static bool is_mt_slot_axis(int code) {
+  return code > ABS_MT_SLOT && code != ABS_MT_TRACKING_ID;
+}
+
+/* Releases all keys and buttons, ends all touches and moves all absolute
+ * axes to their minimum, in every slot for multitouch axes. The kernel
+ * drops events that do not change a value, so this only sends what is
+ * needed. */
+static void reset_device(PoolEntry *entry) {
+  xorg::testing::evemu::Device &device = *entry->device;
+  const xorg::testing::evemu::DeviceCapabilities &caps = entry->capabilities;
+
+  int min, max;
+  for (int code = caps.NextCode(EV_ABS, -1); code != -1;
+       code = caps.NextCode(EV_ABS, code))
+    if (code < ABS_MT_SLOT && caps.GetAbsData(code, &min, &max))
+      device.QueueEvent(EV_ABS, code, min);
+
+  int slot_min, slot_max;
+  if (caps.GetAbsData(ABS_MT_SLOT, &slot_min, &slot_max) &&
+      caps.HasEvent(EV_ABS, ABS_MT_TRACKING_ID)) {
+    for (int slot = slot_min; slot <= slot_max; slot++) {
+      device.QueueEvent(EV_ABS, ABS_MT_SLOT, slot);
+      device.QueueEvent(EV_ABS, ABS_MT_TRACKING_ID, -1);
+      for (int code = caps.NextCode(EV_ABS, ABS_MT_SLOT); code != -1;
+           code = caps.NextCode(EV_ABS, code))
+        if (is_mt_slot_axis(code) && caps.GetAbsData(code, &min, &max))
+          device.QueueEvent(EV_ABS, code, min);
+    }
+    device.QueueEvent(EV_ABS, ABS_MT_SLOT, slot_min);
+  }
+
+  for (int code = caps.NextCode(EV_KEY, -1); code != -1;
+       code = caps.NextCode(EV_KEY, code))
+    device.QueueEvent(EV_KEY, code, 0);
+
+  device.EndFrame();
+  device.Flush();
+}
+
+static bool uses_device_node(::Display *display, int deviceid,
+                             const std::string &node) {
+  xorg::testing::DeviceProperties props(display, deviceid);
+  try {
+    return props.Has("Device Node") && props.GetString("Device Node") == node;
+  } catch (std::runtime_error &e) {
+    return false; /* not a STRING property */
+  }
+}
+
+/* Returns the id of the slave device using this device node, or -1 */
+static int find_x_device(::Display *display, const std::string &node) {
+  int ndevices;
+  XIDeviceInfo *info = XIQueryDevice(display, XIAllDevices, &ndevices);
+  int deviceid = -1;
+
+  for (int i = 0; deviceid == -1 && info && i < ndevices; i++) {
+    if (info[i].use != XISlavePointer && info[i].use != XISlaveKeyboard &&
+        info[i].use != XIFloatingSlave)
+      continue;
+
+    if (uses_device_node(display, info[i].deviceid, node))
+      deviceid = info[i].deviceid;
+  }
+
+  if (info)
+    XIFreeDeviceInfo(info);
+
+  return deviceid;
+}
+
+xorg::testing::evemu::DeviceLease::DeviceLease(const std::string &path)
+  : d_(new Private) {
+  d_->entry = NULL;
+
+  pthread_mutex_lock(&device_pool_mutex);
+  std::vector<PoolEntry*> &entries = device_pool[path];
+  for (unsigned int i = 0; i < entries.size() && !d_->entry; i++) {
+    if (!entries[i]->leased) {
+      d_->entry = entries[i];
+      d_->entry->leased = true;
+    }
+  }
+  pthread_mutex_unlock(&device_pool_mutex);
+
+  if (d_->entry) {
+    try {
+      reset_device(d_->entry);
+    } catch (std::runtime_error &e) {
+      pthread_mutex_lock(&device_pool_mutex);
+      d_->entry->leased = false;
+      pthread_mutex_unlock(&device_pool_mutex);
+      throw;
+    }
+    return;
+  }
+
+  /* create outside the lock, this waits for the device node */
+  PoolEntry *entry = new PoolEntry;
+  entry->device = NULL;
+  try {
+    entry->device = new Device(path);
+    entry->capabilities = DeviceCapabilities(*entry->device);
+  } catch (std::runtime_error &e) {
+    delete entry->device;
+    delete entry;
+    throw;
+  }
+  entry->leased = true;
+  entry->x_deviceid = -1;
+
+  pthread_mutex_lock(&device_pool_mutex);
+  device_pool[path].push_back(entry);
+  pthread_mutex_unlock(&device_pool_mutex);
+
+  d_->entry = entry;
+}
+
+xorg::testing::evemu::DeviceLease::~DeviceLease() {
+  pthread_mutex_lock(&device_pool_mutex);
+  d_->entry->leased = false;
+  pthread_mutex_unlock(&device_pool_mutex);
+}
+
+xorg::testing::evemu::Device& xorg::testing::evemu::DeviceLease::GetDevice() {
+  return *d_->entry->device;
+}
+
+int xorg::testing::evemu::DeviceLease::GetXDeviceId(::Display *display,
+                                                    time_t timeout) {
+  PoolEntry *entry = d_->entry;
+  const std::string &node = entry->device->GetDeviceNode();
+  std::string display_string = DisplayString(display);
+
+  /* a restarted server on the same display numbers devices anew */
+  if (entry->x_deviceid != -1 && entry->x_display == display_string &&
+      uses_device_node(display, entry->x_deviceid, node))
+    return entry->x_deviceid;
+
+  entry->x_deviceid = -1;
+
+  struct timespec start, now;
+  clock_gettime(CLOCK_MONOTONIC, &start);
+
+  while (true) {
+    int deviceid = find_x_device(display, node);
+    if (deviceid != -1) {
+      entry->x_deviceid = deviceid;
+      entry->x_display = display_string;
+      return deviceid;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    if ((now.tv_sec - start.tv_sec) * 1000 +
+        (now.tv_nsec - start.tv_nsec) / 1000000 >= timeout)
+      return -1;
+
+    usleep(10000);
+  }
+}
+
+unsigned int xorg::testing::evemu::DevicePool::GetSize() {
+  unsigned int size = 0;
+
+  pthread_mutex_lock(&device_pool_mutex);
+  std::map<std::string, std::vector<PoolEntry*> >::iterator it;
+  for (it = device_pool.begin(); it != device_pool.end(); it++)
+    size += it->second.size();
+  pthread_mutex_unlock(&device_pool_mutex);
+
+  return size;
+}
+
+void xorg::testing::evemu::DevicePool::Clear() {
+  std::vector<PoolEntry*> idle;
+
+  pthread_mutex_lock(&device_pool_mutex);
+  std::map<std::string, std::vector<PoolEntry*> >::iterator it;
+  for (it = device_pool.begin(); it != device_pool.end(); it++) {
+    std::vector<PoolEntry*> &entries = it->second;
+    for (unsigned int i = 0; i < entries.size(); ) {
+      if (entries[i]->leased) {
+        i++;
+      } else {
+        idle.push_back(entries[i]);
+        entries.erase(entries.begin() + i);
+      }
+    }
+  }
+  pthread_mutex_unlock(&device_pool_mutex);
+
+  for (unsigned int i = 0; i < idle.size(); i++) {
+    delete idle[i]->device;
+    delete idle[i];
+  }
+}
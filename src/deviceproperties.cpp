@@ -0,0 +1,431 @@
+/*******************************************************************************
+ *
+ * X testing environment - typed access to XI device properties
+ *
+ * Copyright © 2026 xorg-gtest contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ ******************************************************************************/
+
+
+#include "xorg/gtest/xorg-gtest-deviceproperties.h"
+#include "xorg/gtest/xorg-gtest-displaycache.h"
+#include "xorg/gtest/xorg-gtest-xserver.h"
+
+#include <stdint.h>
+#include <time.h>
+
+#include <cstring>
+#include <map>
+#include <stdexcept>
+#include <utility>
+
+#include <X11/Xatom.h>
+#include <X11/extensions/XInput2.h>
+
+/* A property value as XIGetProperty() returns it, format/8 bytes per item */
+struct RawProperty {
+  bool exists;
+  Atom type;
+  int format;
+  std::vector<unsigned char> data;
+};
+
+struct xorg::testing::DeviceProperties::Private {
+  ::Display *display;
+  int deviceid;
+  std::map<Atom, RawProperty> cache;
+  std::vector<std::pair<Atom, RawProperty> > pending;
+
+  const RawProperty& Get(const std::string &name);
+  void Queue(const std::string &name, const RawProperty &value);
+  bool WaitFor(const std::string &name, const std::vector<long> *integers,
+               const std::vector<float> *floats, time_t timeout);
+};
+
+static int property_errors;
+
+static int count_property_errors(::Display *display, XErrorEvent *error) {
+  property_errors++;
+  return 0;
+}
+
+static void read_xi_property(::Display *display, int deviceid, Atom property,
+                             RawProperty *value) {
+  Atom type;
+  int format;
+  unsigned long nitems, bytes_after;
+  unsigned char *data = NULL;
+
+  value->exists = false;
+  value->type = None;
+  value->format = 0;
+  value->data.clear();
+
+  /* a missing device must not end up in the default error handler */
+  XErrorHandler old_handler = XSetErrorHandler(count_property_errors);
+  Status status = XIGetProperty(display, deviceid, property, 0, 0x10000, False,
+                                AnyPropertyType, &type, &format, &nitems,
+                                &bytes_after, &data);
+  XSetErrorHandler(old_handler);
+
+  if (status != Success)
+    return;
+
+  if (type != None) {
+    value->exists = true;
+    value->type = type;
+    value->format = format;
+    value->data.assign(data, data + nitems * format / 8);
+  }
+
+  if (data)
+    XFree(data);
+}
+
+static std::vector<unsigned char> encode_integers(const std::vector<long> &values,
+                                                  int format) {
+  std::vector<unsigned char> data(values.size() * format / 8);
+
+  for (unsigned int i = 0; i < values.size(); i++) {
+    if (format == 8) {
+      data[i] = static_cast<uint8_t>(values[i]);
+    } else if (format == 16) {
+      uint16_t v = static_cast<uint16_t>(values[i]);
+      memcpy(&data[i * 2], &v, 2);
+    } else {
+      uint32_t v = static_cast<uint32_t>(values[i]);
+      memcpy(&data[i * 4], &v, 4);
+    }
+  }
+
+  return data;
+}
+
+static std::vector<unsigned char> encode_floats(const std::vector<float> &values) {
+  std::vector<unsigned char> data(values.size() * 4);
+  for (unsigned int i = 0; i < values.size(); i++)
+    memcpy(&data[i * 4], &values[i], 4);
+  return data;
+}
+
+/* Adds XI_PropertyEvent to the XIAllDevices selection on the root window,
+ * returns the previous selection for restore_all_devices_mask() */
+static std::vector<unsigned char> add_property_event_mask(::Display *display) {
+  Window root = DefaultRootWindow(display);
+  std::vector<unsigned char> previous;
+
+  int nmasks;
+  XIEventMask *masks = XIGetSelectedEvents(display, root, &nmasks);
+  for (int i = 0; masks && i < nmasks; i++)
+    if (masks[i].deviceid == XIAllDevices)
+      previous.assign(masks[i].mask, masks[i].mask + masks[i].mask_len);
+  if (masks)
+    XFree(masks);
+
+  std::vector<unsigned char> bits(previous);
+  if (bits.size() < static_cast<size_t>(XIMaskLen(XI_PropertyEvent)))
+    bits.resize(XIMaskLen(XI_PropertyEvent), 0);
+  XISetMask(&bits[0], XI_PropertyEvent);
+
+  XIEventMask mask;
+  mask.deviceid = XIAllDevices;
+  mask.mask_len = bits.size();
+  mask.mask = &bits[0];
+  XISelectEvents(display, root, &mask, 1);
+  XFlush(display);
+
+  return previous;
+}
+
+static void restore_all_devices_mask(::Display *display,
+                                     std::vector<unsigned char> &previous) {
+  XIEventMask mask;
+  mask.deviceid = XIAllDevices;
+  mask.mask_len = previous.size();
+  mask.mask = previous.empty() ? NULL : &previous[0];
+  XISelectEvents(display, DefaultRootWindow(display), &mask, 1);
+  XFlush(display);
+}
+
+static long remaining_ms(const struct timespec &deadline) {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (deadline.tv_sec - now.tv_sec) * 1000 +
+         (deadline.tv_nsec - now.tv_nsec) / 1000000;
+}
+
+const RawProperty& xorg::testing::DeviceProperties::Private::Get(const std::string &name) {
+  Atom property = DisplayCache::GetAtom(display, name);
+
+  std::map<Atom, RawProperty>::iterator it = cache.find(property);
+  if (it != cache.end())
+    return it->second;
+
+  RawProperty &value = cache[property];
+  read_xi_property(display, deviceid, property, &value);
+  return value;
+}
+
+void xorg::testing::DeviceProperties::Private::Queue(const std::string &name,
+                                                     const RawProperty &value) {
+  Atom property = DisplayCache::GetAtom(display, name);
+  pending.push_back(std::make_pair(property, value));
+  cache[property] = value;
+}
+
+bool xorg::testing::DeviceProperties::Private::WaitFor(const std::string &name,
+                                                       const std::vector<long> *integers,
+                                                       const std::vector<float> *floats,
+                                                       time_t timeout) {
+  Atom property = DisplayCache::GetAtom(display, name);
+  int opcode;
+  if (!DisplayCache::QueryExtension(display, "XInputExtension", &opcode, NULL, NULL))
+    throw std::runtime_error("Failed to query XInput extension");
+
+  struct timespec deadline;
+  clock_gettime(CLOCK_MONOTONIC, &deadline);
+  deadline.tv_sec += timeout / 1000;
+  deadline.tv_nsec += (timeout % 1000) * 1000000L;
+  if (deadline.tv_nsec >= 1000000000L) {
+    deadline.tv_sec++;
+    deadline.tv_nsec -= 1000000000L;
+  }
+
+  /* select before reading, so no change goes unnoticed */
+  std::vector<unsigned char> previous_mask = add_property_event_mask(display);
+
+  bool matched = false;
+  RawProperty &value = cache[property];
+
+  while (true) {
+    read_xi_property(display, deviceid, property, &value);
+    if (value.exists) {
+      std::vector<unsigned char> expected = integers ?
+        encode_integers(*integers, value.format) : encode_floats(*floats);
+      if (value.data == expected) {
+        matched = true;
+        break;
+      }
+    }
+
+    /* wait for a change of this property */
+    bool changed = false;
+    while (!changed) {
+      long remaining = remaining_ms(deadline);
+      if (remaining <= 0 ||
+          !XServer::WaitForEventOfType(display, GenericEvent, opcode,
+                                       XI_PropertyEvent, remaining))
+        break;
+
+      XEvent event;
+      XNextEvent(display, &event);
+      XGenericEventCookie *cookie = &event.xcookie;
+      if (!XGetEventData(display, cookie))
+        continue;
+
+      XIPropertyEvent *property_event = static_cast<XIPropertyEvent*>(cookie->data);
+      changed = (property_event->deviceid == deviceid &&
+                 property_event->property == property);
+      XFreeEventData(display, cookie);
+    }
+
+    if (!changed)
+      break;
+  }
+
+  restore_all_devices_mask(display, previous_mask);
+
+  return matched;
+}
+
+xorg::testing::DeviceProperties::DeviceProperties(::Display *display, int deviceid)
+  : d_(new Private) {
+  d_->display = display;
+  d_->deviceid = deviceid;
+}
+
+xorg::testing::DeviceProperties::~DeviceProperties() {}
+
+void xorg::testing::DeviceProperties::Fetch(const std::vector<std::string> &properties) {
+  std::vector<Atom> atoms;
+  DisplayCache::GetAtoms(d_->display, properties, &atoms);
+
+  for (unsigned int i = 0; i < atoms.size(); i++)
+    read_xi_property(d_->display, d_->deviceid, atoms[i], &d_->cache[atoms[i]]);
+}
+
+void xorg::testing::DeviceProperties::Invalidate() {
+  d_->cache.clear();
+}
+
+bool xorg::testing::DeviceProperties::Has(const std::string &property) {
+  return d_->Get(property).exists;
+}
+
+int xorg::testing::DeviceProperties::GetFormat(const std::string &property) {
+  return d_->Get(property).format;
+}
+
+std::vector<long> xorg::testing::DeviceProperties::GetIntegers(const std::string &property) {
+  const RawProperty &value = d_->Get(property);
+  if (!value.exists)
+    throw std::runtime_error("Device has no property " + property);
+
+  bool is_signed = (value.type == XA_INTEGER);
+  std::vector<long> values;
+
+  for (unsigned int i = 0; i < value.data.size(); i += value.format / 8) {
+    if (value.format == 8) {
+      uint8_t v = value.data[i];
+      values.push_back(is_signed ? static_cast<int8_t>(v) : v);
+    } else if (value.format == 16) {
+      uint16_t v;
+      memcpy(&v, &value.data[i], 2);
+      values.push_back(is_signed ? static_cast<int16_t>(v) : v);
+    } else {
+      uint32_t v;
+      memcpy(&v, &value.data[i], 4);
+      values.push_back(is_signed ? static_cast<int32_t>(v) : static_cast<long>(v));
+    }
+  }
+
+  return values;
+}
+
+std::vector<float> xorg::testing::DeviceProperties::GetFloats(const std::string &property) {
+  const RawProperty &value = d_->Get(property);
+  if (!value.exists || value.format != 32 ||
+      value.type != DisplayCache::GetAtom(d_->display, "FLOAT"))
+    throw std::runtime_error("Device has no FLOAT property " + property);
+
+  std::vector<float> values(value.data.size() / 4);
+  for (unsigned int i = 0; i < values.size(); i++)
+    memcpy(&values[i], &value.data[i * 4], 4);
+
+  return values;
+}
+
+std::vector<Atom> xorg::testing::DeviceProperties::GetAtoms(const std::string &property) {
+  const RawProperty &value = d_->Get(property);
+  if (!value.exists || value.format != 32 || value.type != XA_ATOM)
+    throw std::runtime_error("Device has no ATOM property " + property);
+
+  std::vector<Atom> values;
+  for (unsigned int i = 0; i < value.data.size(); i += 4) {
+    uint32_t v;
+    memcpy(&v, &value.data[i], 4);
+    values.push_back(v);
+  }
+
+  return values;
+}
+
+std::string xorg::testing::DeviceProperties::GetString(const std::string &property) {
+  const RawProperty &value = d_->Get(property);
+  if (!value.exists || value.format != 8 || value.type != XA_STRING)
+    throw std::runtime_error("Device has no STRING property " + property);
+
+  std::string s(value.data.begin(), value.data.end());
+  /* drop the terminating NUL */
+  if (!s.empty() && s[s.size() - 1] == '\0')
+    s.erase(s.size() - 1);
+
+  return s;
+}
+
+void xorg::testing::DeviceProperties::SetIntegers(const std::string &property,
+                                                  const std::vector<long> &values) {
+  const RawProperty &current = d_->Get(property);
+
+  RawProperty value;
+  value.exists = true;
+  value.type = current.exists ? current.type : XA_INTEGER;
+  value.format = current.exists ? current.format : 32;
+  value.data = encode_integers(values, value.format);
+
+  d_->Queue(property, value);
+}
+
+void xorg::testing::DeviceProperties::SetFloats(const std::string &property,
+                                                const std::vector<float> &values) {
+  RawProperty value;
+  value.exists = true;
+  value.type = DisplayCache::GetAtom(d_->display, "FLOAT");
+  value.format = 32;
+  value.data = encode_floats(values);
+
+  d_->Queue(property, value);
+}
+
+void xorg::testing::DeviceProperties::SetAtoms(const std::string &property,
+                                               const std::vector<Atom> &values) {
+  std::vector<long> atoms(values.begin(), values.end());
+
+  RawProperty value;
+  value.exists = true;
+  value.type = XA_ATOM;
+  value.format = 32;
+  value.data = encode_integers(atoms, 32);
+
+  d_->Queue(property, value);
+}
+
+bool xorg::testing::DeviceProperties::Flush() {
+  if (d_->pending.empty())
+    return true;
+
+  XErrorHandler old_handler = XSetErrorHandler(count_property_errors);
+  property_errors = 0;
+
+  std::vector<std::pair<Atom, RawProperty> >::iterator it;
+  for (it = d_->pending.begin(); it != d_->pending.end(); it++) {
+    RawProperty &value = it->second;
+    XIChangeProperty(d_->display, d_->deviceid, it->first, value.type,
+                     value.format, PropModeReplace,
+                     value.data.empty() ? NULL : &value.data[0],
+                     value.data.size() / (value.format / 8));
+  }
+
+  XSync(d_->display, False);
+  XSetErrorHandler(old_handler);
+
+  d_->pending.clear();
+
+  if (property_errors > 0) {
+    d_->cache.clear();
+    return false;
+  }
+
+  return true;
+}
+
+bool xorg::testing::DeviceProperties::WaitForPropertyValue(const std::string &property,
+                                                           const std::vector<long> &values,
+                                                           time_t timeout) {
+  return d_->WaitFor(property, &values, NULL, timeout);
+}
+
+bool xorg::testing::DeviceProperties::WaitForPropertyValue(const std::string &property,
+                                                           const std::vector<float> &values,
+                                                           time_t timeout) {
+  return d_->WaitFor(property, NULL, &values, timeout);
+}
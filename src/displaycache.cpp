@@ -0,0 +1,226 @@
+/*******************************************************************************
+ *
+ * X testing environment - per-display cache of atoms and extensions
+ *
+ * Copyright © 2026 xorg-gtest contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ ******************************************************************************/
+
+
+#include "xorg/gtest/xorg-gtest-displaycache.h"
+
+#include <pthread.h>
+
+#include <map>
+#include <stdexcept>
+
+#include <X11/Xlibint.h>
+
+struct ExtensionInfo {
+  bool present;
+  int opcode;
+  int event_base;
+  int error_base;
+};
+
+struct DisplayCacheEntry {
+  std::map<std::string, Atom> atoms;
+  std::map<Atom, std::string> names;
+  std::map<std::string, ExtensionInfo> extensions;
+};
+
+/* Xlib calls are made without holding the mutex, they may take a while
+ * and the close hook below needs the mutex */
+static pthread_mutex_t cache_mutex = PTHREAD_MUTEX_INITIALIZER;
+static std::map< ::Display*, DisplayCacheEntry> display_caches;
+static unsigned long cache_hits;
+static unsigned long cache_misses;
+
+static int close_display_cache(::Display *display, XExtCodes *codes) {
+  pthread_mutex_lock(&cache_mutex);
+  display_caches.erase(display);
+  pthread_mutex_unlock(&cache_mutex);
+  return 0;
+}
+
+/* Display pointers are reused after XCloseDisplay(), so the cache must be
+ * dropped when the display is closed */
+static void register_display(::Display *display) {
+  pthread_mutex_lock(&cache_mutex);
+  bool known = display_caches.find(display) != display_caches.end();
+  pthread_mutex_unlock(&cache_mutex);
+
+  if (known)
+    return;
+
+  XExtCodes *codes = XAddExtension(display);
+  if (!codes)
+    throw std::runtime_error("Failed to register display close hook");
+  XESetCloseDisplay(display, codes->extension, close_display_cache);
+
+  pthread_mutex_lock(&cache_mutex);
+  display_caches[display];
+  pthread_mutex_unlock(&cache_mutex);
+}
+
+Atom xorg::testing::DisplayCache::GetAtom(::Display *display, const std::string &name) {
+  std::vector<std::string> names(1, name);
+  std::vector<Atom> atoms;
+  GetAtoms(display, names, &atoms);
+  return atoms[0];
+}
+
+void xorg::testing::DisplayCache::GetAtoms(::Display *display,
+                                           const std::vector<std::string> &names,
+                                           std::vector<Atom> *atoms) {
+  register_display(display);
+  atoms->assign(names.size(), None);
+
+  std::vector<unsigned int> missing;
+
+  pthread_mutex_lock(&cache_mutex);
+  DisplayCacheEntry &cache = display_caches[display];
+  for (unsigned int i = 0; i < names.size(); i++) {
+    std::map<std::string, Atom>::const_iterator it = cache.atoms.find(names[i]);
+    if (it != cache.atoms.end()) {
+      (*atoms)[i] = it->second;
+      cache_hits++;
+    } else {
+      missing.push_back(i);
+      cache_misses++;
+    }
+  }
+  pthread_mutex_unlock(&cache_mutex);
+
+  if (missing.empty())
+    return;
+
+  std::vector<char*> missing_names;
+  for (unsigned int i = 0; i < missing.size(); i++)
+    missing_names.push_back(const_cast<char*>(names[missing[i]].c_str()));
+
+  std::vector<Atom> interned(missing.size(), None);
+  if (!XInternAtoms(display, &missing_names[0], missing_names.size(), False,
+                    &interned[0]))
+    throw std::runtime_error("Failed to intern atoms");
+
+  pthread_mutex_lock(&cache_mutex);
+  DisplayCacheEntry &updated = display_caches[display];
+  for (unsigned int i = 0; i < missing.size(); i++) {
+    (*atoms)[missing[i]] = interned[i];
+    updated.atoms[names[missing[i]]] = interned[i];
+    updated.names[interned[i]] = names[missing[i]];
+  }
+  pthread_mutex_unlock(&cache_mutex);
+}
+
+std::string xorg::testing::DisplayCache::GetAtomName(::Display *display, Atom atom) {
+  register_display(display);
+
+  pthread_mutex_lock(&cache_mutex);
+  DisplayCacheEntry &cache = display_caches[display];
+  std::map<Atom, std::string>::const_iterator it = cache.names.find(atom);
+  if (it != cache.names.end()) {
+    std::string name = it->second;
+    cache_hits++;
+    pthread_mutex_unlock(&cache_mutex);
+    return name;
+  }
+  cache_misses++;
+  pthread_mutex_unlock(&cache_mutex);
+
+  char *name = XGetAtomName(display, atom);
+  if (!name)
+    return "";
+
+  std::string result(name);
+  XFree(name);
+
+  pthread_mutex_lock(&cache_mutex);
+  DisplayCacheEntry &updated = display_caches[display];
+  updated.names[atom] = result;
+  updated.atoms[result] = atom;
+  pthread_mutex_unlock(&cache_mutex);
+
+  return result;
+}
+
+bool xorg::testing::DisplayCache::QueryExtension(::Display *display,
+                                                 const std::string &name,
+                                                 int *opcode, int *event_base,
+                                                 int *error_base) {
+  register_display(display);
+
+  ExtensionInfo info;
+  bool cached = false;
+
+  pthread_mutex_lock(&cache_mutex);
+  DisplayCacheEntry &cache = display_caches[display];
+  std::map<std::string, ExtensionInfo>::const_iterator it = cache.extensions.find(name);
+  if (it != cache.extensions.end()) {
+    info = it->second;
+    cached = true;
+    cache_hits++;
+  } else {
+    cache_misses++;
+  }
+  pthread_mutex_unlock(&cache_mutex);
+
+  if (!cached) {
+    info.present = XQueryExtension(display, name.c_str(), &info.opcode,
+                                   &info.event_base, &info.error_base);
+
+    pthread_mutex_lock(&cache_mutex);
+    display_caches[display].extensions[name] = info;
+    pthread_mutex_unlock(&cache_mutex);
+  }
+
+  if (opcode)
+    *opcode = info.opcode;
+  if (event_base)
+    *event_base = info.event_base;
+  if (error_base)
+    *error_base = info.error_base;
+
+  return info.present;
+}
+
+unsigned long xorg::testing::DisplayCache::GetHits() {
+  pthread_mutex_lock(&cache_mutex);
+  unsigned long hits = cache_hits;
+  pthread_mutex_unlock(&cache_mutex);
+  return hits;
+}
+
+unsigned long xorg::testing::DisplayCache::GetMisses() {
+  pthread_mutex_lock(&cache_mutex);
+  unsigned long misses = cache_misses;
+  pthread_mutex_unlock(&cache_mutex);
+  return misses;
+}
+
+void xorg::testing::DisplayCache::ResetStatistics() {
+  pthread_mutex_lock(&cache_mutex);
+  cache_hits = 0;
+  cache_misses = 0;
+  pthread_mutex_unlock(&cache_mutex);
+}
@@ -30,39 +30,410 @@
 #include "xorg/gtest/xorg-gtest-process.h"
 #include "xorg/gtest/xorg-gtest-xserver.h"
 
+#include <pthread.h>
 #include <sys/types.h>
+#include <time.h>
 #include <unistd.h>
 
+#include <algorithm>
 #include <cerrno>
 #include <csignal>
+#include <cstdio>
 #include <cstdlib>
 #include <cstring>
+#include <deque>
+#include <fstream>
 #include <iostream>
+#include <map>
+#include <set>
+#include <sstream>
 #include <stdexcept>
+#include <vector>
 
 #include <X11/Xlib.h>
+#include <X11/XKBlib.h>
+#include <X11/extensions/XInput2.h>
+#include <X11/extensions/XRes.h>
 
 #include "defines.h"
 
+struct PropertySnapshot {
+  Atom type;
+  int format;
+  std::vector<unsigned char> data;
+
+  bool operator==(const PropertySnapshot &other) const {
+    return type == other.type && format == other.format && data == other.data;
+  }
+};
+
+/* The parts of the server state a test may leave behind that survive
+ * killing all of its clients */
+struct ServerSnapshot {
+  int nclients;
+  std::map<int, std::map<Atom, PropertySnapshot> > devices;
+  int pointer_x;
+  int pointer_y;
+  Window focus;
+  int revert_to;
+  unsigned int locked_mods;
+  int locked_group;
+};
+
+static bool get_device_property(::Display *display, int deviceid, Atom property,
+                                PropertySnapshot *snapshot) {
+  Atom type;
+  int format;
+  unsigned long nitems, bytes_after;
+  unsigned char *data;
+
+  if (XIGetProperty(display, deviceid, property, 0, 0x10000, False,
+                    AnyPropertyType, &type, &format, &nitems, &bytes_after,
+                    &data) != Success)
+    return false;
+
+  snapshot->type = type;
+  snapshot->format = format;
+  snapshot->data.assign(data, data + nitems * format / 8);
+  XFree(data);
+
+  return true;
+}
+
+static void take_snapshot(::Display *display, ServerSnapshot *snapshot) {
+  XResClient *clients;
+  if (!XResQueryClients(display, &snapshot->nclients, &clients))
+    throw std::runtime_error("Failed to query clients");
+  XFree(clients);
+
+  snapshot->devices.clear();
+
+  int ndevices;
+  XIDeviceInfo *info = XIQueryDevice(display, XIAllDevices, &ndevices);
+  for (int i = 0; i < ndevices; i++) {
+    std::map<Atom, PropertySnapshot> &properties = snapshot->devices[info[i].deviceid];
+
+    int nprops;
+    Atom *props = XIListProperties(display, info[i].deviceid, &nprops);
+    for (int j = 0; j < nprops; j++) {
+      PropertySnapshot property;
+      if (get_device_property(display, info[i].deviceid, props[j], &property))
+        properties[props[j]] = property;
+    }
+    XFree(props);
+  }
+  XIFreeDeviceInfo(info);
+
+  Window root, child;
+  int win_x, win_y;
+  unsigned int mask;
+  XQueryPointer(display, DefaultRootWindow(display), &root, &child,
+                &snapshot->pointer_x, &snapshot->pointer_y, &win_x, &win_y,
+                &mask);
+
+  XGetInputFocus(display, &snapshot->focus, &snapshot->revert_to);
+
+  XkbStateRec state;
+  XkbGetState(display, XkbUseCoreKbd, &state);
+  snapshot->locked_mods = state.locked_mods;
+  snapshot->locked_group = state.locked_group;
+}
+
+static int reset_errors;
+
+static int reset_error_handler(::Display *display, XErrorEvent *error) {
+  reset_errors++;
+  return 0;
+}
+
+/* Restore what killing the clients didn't. Errors are expected here, e.g.
+ * for properties a driver refuses to delete, so they are ignored and
+ * left for the snapshot comparison to judge */
+static void restore_snapshot(::Display *display, const ServerSnapshot &snapshot) {
+  XErrorHandler old_handler = XSetErrorHandler(reset_error_handler);
+  reset_errors = 0;
+
+  XUngrabPointer(display, CurrentTime);
+  XUngrabKeyboard(display, CurrentTime);
+
+  std::map<int, std::map<Atom, PropertySnapshot> >::const_iterator device;
+  for (device = snapshot.devices.begin(); device != snapshot.devices.end(); device++) {
+    int nprops;
+    Atom *props = XIListProperties(display, device->first, &nprops);
+    for (int i = 0; i < nprops; i++) {
+      std::map<Atom, PropertySnapshot>::const_iterator baseline =
+        device->second.find(props[i]);
+
+      if (baseline == device->second.end()) {
+        XIDeleteProperty(display, device->first, props[i]);
+        continue;
+      }
+
+      PropertySnapshot current;
+      if (get_device_property(display, device->first, props[i], &current) &&
+          current == baseline->second)
+        continue;
+
+      const PropertySnapshot &p = baseline->second;
+      XIChangeProperty(display, device->first, props[i], p.type, p.format,
+                       PropModeReplace,
+                       const_cast<unsigned char*>(p.data.empty() ? NULL : &p.data[0]),
+                       p.data.size() / (p.format / 8));
+    }
+    XFree(props);
+  }
+
+  XWarpPointer(display, None, DefaultRootWindow(display), 0, 0, 0, 0,
+               snapshot.pointer_x, snapshot.pointer_y);
+  XSetInputFocus(display, snapshot.focus, snapshot.revert_to, CurrentTime);
+  XkbLockModifiers(display, XkbUseCoreKbd, 0xff, snapshot.locked_mods);
+  XkbLockGroup(display, XkbUseCoreKbd, snapshot.locked_group);
+
+  XSync(display, False);
+  XSetErrorHandler(old_handler);
+}
+
+/* Devices added by a test are not compared, they usually disappear
+ * asynchronously once the test destroys its uinput devices */
+static bool snapshot_matches(const ServerSnapshot &baseline,
+                             const ServerSnapshot &current) {
+  if (baseline.nclients != current.nclients ||
+      baseline.pointer_x != current.pointer_x ||
+      baseline.pointer_y != current.pointer_y ||
+      baseline.focus != current.focus ||
+      baseline.locked_mods != current.locked_mods ||
+      baseline.locked_group != current.locked_group)
+    return false;
+
+  std::map<int, std::map<Atom, PropertySnapshot> >::const_iterator device;
+  for (device = baseline.devices.begin(); device != baseline.devices.end(); device++) {
+    std::map<int, std::map<Atom, PropertySnapshot> >::const_iterator other =
+      current.devices.find(device->first);
+    if (other == current.devices.end() || other->second != device->second)
+      return false;
+  }
+
+  return true;
+}
+
+static long now_ms() {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return now.tv_sec * 1000 + now.tv_nsec / 1000000;
+}
+
+static std::string log_tail(const std::string &path, unsigned int lines) {
+  std::ifstream file(path.c_str());
+  std::deque<std::string> tail;
+  std::string line;
+
+  while (std::getline(file, line)) {
+    tail.push_back(line);
+    if (tail.size() > lines)
+      tail.pop_front();
+  }
+
+  std::string result;
+  for (std::deque<std::string>::const_iterator it = tail.begin(); it != tail.end(); it++)
+    result += *it + "\n";
+  return result;
+}
+
+/* The environment between SetUp() and TearDown() */
+static xorg::testing::Environment *current_environment = NULL;
+
+/* Runs after each test, before the result is printed. Restarts the server
+ * if it died during the test and otherwise resets it, depending on the
+ * settings of the current environment */
+class ServerListener : public ::testing::EmptyTestEventListener {
+ public:
+  ServerListener() : crashes_(0), time_lost_(0) {}
+
+  virtual void OnTestEnd(const ::testing::TestInfo &test_info) {
+    xorg::testing::Environment *environment = current_environment;
+    if (!environment)
+      return;
+
+    if (environment->GetRestartOnCrash() && CheckServer(environment, test_info))
+      return;
+
+    if (environment->GetResetMode() == xorg::testing::Environment::RESET_NONE)
+      return;
+
+    try {
+      environment->Reset();
+    } catch (const std::exception &e) {
+      std::cerr << "Warning: Failed to reset server after "
+                << test_info.test_case_name() << "." << test_info.name()
+                << ": " << e.what() << "\n";
+    }
+  }
+
+  virtual void OnTestProgramEnd(const ::testing::UnitTest &unit_test) {
+    if (crashes_ == 0)
+      return;
+
+    std::cout << "[ WATCHDOG ] The server crashed " << crashes_
+              << " time(s), " << time_lost_
+              << " ms lost to the failed tests and restarts.\n";
+  }
+
+ private:
+  /* true if the server died during the test */
+  bool CheckServer(xorg::testing::Environment *environment,
+                   const ::testing::TestInfo &test_info) {
+    long start = now_ms();
+    bool restarted;
+
+    try {
+      restarted = environment->Recover();
+    } catch (const std::exception &e) {
+      ADD_FAILURE() << "The server died during this test and could not be "
+                       "restarted: " << e.what();
+      return true;
+    }
+
+    if (!restarted)
+      return false;
+
+    crashes_++;
+    time_lost_ += test_info.result()->elapsed_time() + now_ms() - start;
+
+    std::string crash_log = environment->GetLogFile() + ".crash";
+    ADD_FAILURE() << "The server died during this test and was restarted. "
+                  << "Last lines of " << crash_log << ":\n"
+                  << log_tail(crash_log, 20);
+    return true;
+  }
+
+  unsigned int crashes_;
+  long time_lost_;
+};
+
 struct xorg::testing::Environment::Private {
   Private() : path_to_conf(DUMMY_CONF_PATH),
               path_to_log_file(DEFAULT_XORG_LOGFILE),
               path_to_server(DEFAULT_XORG_SERVER),
-              display(DEFAULT_DISPLAY)
+              display(DEFAULT_DISPLAY),
+              reset_mode(RESET_NONE),
+              harness(NULL),
+              lazy(false),
+              restart_on_crash(true),
+              started(false),
+              extra_servers_started(false),
+              next_assignment(0)
   {
+    pthread_mutex_init(&assign_mutex, NULL);
+  }
+
+  ~Private() {
+    /* the destructor terminates the server */
+    for (unsigned int i = 0; i < extra_servers.size(); i++)
+      delete extra_servers[i];
+    pthread_mutex_destroy(&assign_mutex);
+  }
+
+  /* Without waiting for each other, clients queue up on the sockets until
+   * the servers are ready */
+  void StartExtraServers() {
+    if (extra_servers_started)
+      return;
+
+    for (unsigned int i = 0; i < extra_servers.size(); i++) {
+      extra_servers[i]->SetPrebindSocket(true);
+      extra_servers[i]->Start();
+    }
+    extra_servers_started = true;
   }
+
+  void StopExtraServers() {
+    if (!extra_servers_started)
+      return;
+
+    for (unsigned int i = 0; i < extra_servers.size(); i++)
+      if (!extra_servers[i]->Terminate(1000))
+        extra_servers[i]->Kill(1000);
+    extra_servers_started = false;
+  }
+
+  void StartServer() {
+    server.SetDisplayNumber(display);
+    server.SetOption("-logfile", path_to_log_file);
+    server.SetOption("-config", path_to_conf);
+    /* Closing our connection must not trigger a second regeneration */
+    if (reset_mode == RESET_REGENERATE)
+      server.SetOption("-noreset");
+    server.Start(path_to_server);
+    started = true;
+
+    if (reset_mode != RESET_NONE) {
+      harness = XOpenDisplay(server.GetDisplayString().c_str());
+      if (!harness)
+        throw std::runtime_error("Failed to connect to " + server.GetDisplayString());
+      take_snapshot(harness, &baseline);
+    }
+  }
+
+  void StopServer() {
+    if (harness)
+      XCloseDisplay(harness);
+    harness = NULL;
+
+    if (!started)
+      return;
+
+    if (!server.Terminate(1000))
+      server.Kill(1000);
+    started = false;
+  }
+
   std::string path_to_conf;
   std::string path_to_log_file;
   std::string path_to_server;
   int display;
+  enum ResetMode reset_mode;
+  ::Display *harness;
+  ServerSnapshot baseline;
+  bool lazy;
+  bool restart_on_crash;
+  bool started;
   XServer server;
+  std::vector<XServer*> extra_servers;
+  std::vector<std::string> extra_tags;
+  bool extra_servers_started;
+  pthread_mutex_t assign_mutex;
+  std::map<pthread_t, unsigned int> assignments;
+  unsigned int next_assignment;
 };
 
+static std::set<std::string>& no_server_test_cases() {
+  static std::set<std::string> test_cases;
+  return test_cases;
+}
+
+/* true if any test case selected to run was not declared as not needing
+ * a server */
+static bool server_needed() {
+  ::testing::UnitTest *unit_test = ::testing::UnitTest::GetInstance();
+
+  for (int i = 0; i < unit_test->total_test_case_count(); i++) {
+    const ::testing::TestCase *test_case = unit_test->GetTestCase(i);
+    if (test_case->should_run() &&
+        no_server_test_cases().count(test_case->name()) == 0)
+      return true;
+  }
+
+  return false;
+}
+
 xorg::testing::Environment::Environment()
     : d_(new Private) {
 }
 
-xorg::testing::Environment::~Environment() {}
+xorg::testing::Environment::~Environment() {
+  if (current_environment == this)
+    current_environment = NULL;
+}
 
 void xorg::testing::Environment::set_log_file(const std::string& path_to_log_file)
 {
@@ -104,22 +475,203 @@ void xorg::testing::Environment::SetDisplayNumber(int display_num)
   d_->display = display_num;
 }
 
+void xorg::testing::Environment::SetResetMode(enum ResetMode mode)
+{
+  d_->reset_mode = mode;
+}
+
+enum xorg::testing::Environment::ResetMode xorg::testing::Environment::GetResetMode() const
+{
+  return d_->reset_mode;
+}
+
+void xorg::testing::Environment::SetLazyStart(bool lazy)
+{
+  d_->lazy = lazy;
+}
+
+void xorg::testing::Environment::SetRestartOnCrash(bool restart)
+{
+  d_->restart_on_crash = restart;
+}
+
+bool xorg::testing::Environment::GetRestartOnCrash() const
+{
+  return d_->restart_on_crash;
+}
+
+bool xorg::testing::Environment::RegisterNoServerTestCase(const std::string &test_case_name)
+{
+  no_server_test_cases().insert(test_case_name);
+  return true;
+}
+
+void xorg::testing::Environment::RequireServer()
+{
+  if (!current_environment)
+    return;
+
+  current_environment->d_->StartExtraServers();
+  if (!current_environment->d_->started)
+    current_environment->d_->StartServer();
+}
+
+xorg::testing::XServer& xorg::testing::Environment::AddServer(const std::string &tag,
+                                                              int display_num)
+{
+  if (tag == "default" ||
+      std::find(d_->extra_tags.begin(), d_->extra_tags.end(), tag) != d_->extra_tags.end())
+    throw std::runtime_error("A server with the tag " + tag + " exists already");
+
+  XServer *server = new XServer;
+  server->SetDisplayNumber(display_num);
+  server->SetServerPath(d_->path_to_server);
+  server->SetOption("-config", d_->path_to_conf);
+  server->SetOption("-logfile", LOGFILE_DIR "/Xorg.GTest." + tag + ".log");
+
+  d_->extra_servers.push_back(server);
+  d_->extra_tags.push_back(tag);
+
+  return *server;
+}
+
+unsigned int xorg::testing::Environment::GetServerCount() const
+{
+  return d_->extra_servers.size() + 1;
+}
+
+xorg::testing::XServer& xorg::testing::Environment::GetServer(unsigned int index)
+{
+  if (index == 0)
+    return d_->server;
+  if (index > d_->extra_servers.size())
+    throw std::runtime_error("Invalid server index");
+
+  return *d_->extra_servers[index - 1];
+}
+
+xorg::testing::XServer& xorg::testing::Environment::GetServer(const std::string &tag)
+{
+  if (tag == "default")
+    return d_->server;
+
+  std::vector<std::string>::const_iterator it =
+    std::find(d_->extra_tags.begin(), d_->extra_tags.end(), tag);
+  if (it == d_->extra_tags.end())
+    throw std::runtime_error("No server with the tag " + tag);
+
+  return *d_->extra_servers[it - d_->extra_tags.begin()];
+}
+
+xorg::testing::XServer& xorg::testing::Environment::AssignServer()
+{
+  pthread_mutex_lock(&d_->assign_mutex);
+
+  std::map<pthread_t, unsigned int>::iterator it = d_->assignments.find(pthread_self());
+  unsigned int index;
+  if (it != d_->assignments.end()) {
+    index = it->second;
+  } else {
+    index = d_->next_assignment++ % GetServerCount();
+    d_->assignments[pthread_self()] = index;
+  }
+
+  pthread_mutex_unlock(&d_->assign_mutex);
+
+  return GetServer(index);
+}
+
 void xorg::testing::Environment::SetUp() {
-  d_->server.SetDisplayNumber(d_->display);
-  d_->server.SetOption("-logfile", d_->path_to_log_file);
-  d_->server.SetOption("-config", d_->path_to_conf);
-  d_->server.Start(d_->path_to_server);
+  current_environment = this;
 
-  Process::SetEnv("DISPLAY", d_->server.GetDisplayString(), true);
+  std::stringstream display;
+  display << ":" << d_->display;
+  Process::SetEnv("DISPLAY", display.str(), true);
+
+  if (!d_->lazy && server_needed()) {
+    d_->StartExtraServers();
+    d_->StartServer();
+  }
+
+  static bool listener_installed = false;
+  if (!listener_installed) {
+    ::testing::UnitTest::GetInstance()->listeners().Append(new ServerListener);
+    listener_installed = true;
+  }
 }
 
 void xorg::testing::Environment::TearDown() {
-  if (!d_->server.Terminate(1000))
-    Kill();
+  d_->StopServer();
+  d_->StopExtraServers();
+
+  if (current_environment == this)
+    current_environment = NULL;
+}
+
+bool xorg::testing::Environment::Reset() {
+  if (d_->reset_mode == RESET_NONE || !d_->harness)
+    return true;
+
+  switch (d_->reset_mode) {
+    case RESET_CLIENTS:
+      XServer::KillOtherClients(d_->harness);
+      restore_snapshot(d_->harness, d_->baseline);
+      break;
+    case RESET_REGENERATE:
+      /* regeneration closes all connections, including ours */
+      XCloseDisplay(d_->harness);
+      d_->harness = NULL;
+      if (d_->server.Regenerate())
+        d_->harness = XOpenDisplay(d_->server.GetDisplayString().c_str());
+      break;
+    case RESET_RESTART:
+      d_->StopServer();
+      d_->StartServer();
+      return true;
+    default:
+      break;
+  }
+
+  if (d_->harness) {
+    ServerSnapshot current;
+    take_snapshot(d_->harness, &current);
+    if (snapshot_matches(d_->baseline, current))
+      return true;
+  }
+
+  std::cerr << "Warning: Server state differs from the snapshot after reset, "
+               "restarting server.\n";
+  d_->StopServer();
+  d_->StartServer();
+
+  return false;
+}
+
+bool xorg::testing::Environment::Recover() {
+  if (!d_->started || d_->server.GetState() == Process::RUNNING)
+    return false;
+
+  /* Xlib cannot close a connection to a dead server without calling the
+   * I/O error handler, so the harness connection is leaked */
+  d_->harness = NULL;
+  d_->started = false;
+
+  /* Starting the server truncates the log */
+  rename(d_->path_to_log_file.c_str(),
+         (d_->path_to_log_file + ".crash").c_str());
+
+  d_->StartServer();
+  return true;
 }
 
 void xorg::testing::Environment::Kill() {
+  if (!d_->started)
+    return;
+
   d_->server.Kill(1000);
+  /* killed on purpose, not for Recover() to restart */
+  d_->harness = NULL;
+  d_->started = false;
 }
 
 
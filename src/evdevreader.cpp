@@ -0,0 +1,219 @@
+/*******************************************************************************
+ *
+ * X testing environment - readback of injected evdev events
+ *
+ * Copyright © 2026 xorg-gtest contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ ******************************************************************************/
+
+
+#include "xorg/gtest/evemu/xorg-gtest-evdevreader.h"
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/ioctl.h>
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <sstream>
+#include <stdexcept>
+
+struct InjectedEvent {
+  struct input_event event;
+  uint64_t sent_ns;
+};
+
+struct xorg::testing::evemu::EvdevReader::Private {
+  Device *device;
+  int fd;
+  clockid_t clock;
+  std::vector<InjectedEvent> injected;
+  std::vector<struct input_event> events;
+  LatencyStats latency;
+};
+
+static uint64_t clock_ns(clockid_t clock) {
+  struct timespec ts;
+  clock_gettime(clock, &ts);
+  return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static uint64_t event_ns(const struct input_event &ev) {
+  return ev.time.tv_sec * 1000000000ULL + ev.time.tv_usec * 1000ULL;
+}
+
+static std::string describe_event(const struct input_event &ev) {
+  std::stringstream s;
+  s << "type " << ev.type << " code " << ev.code << " value " << ev.value;
+  return s.str();
+}
+
+xorg::testing::evemu::EvdevReader::EvdevReader(Device& device)
+    : d_(new Private) {
+  d_->device = &device;
+  memset(&d_->latency, 0, sizeof(d_->latency));
+
+  const std::string &node = device.GetDeviceNode();
+  if (node.empty())
+    throw std::runtime_error("Device node unknown");
+
+  /* no EVIOCGRAB, the server reads the same events */
+  d_->fd = open(node.c_str(), O_RDONLY | O_NONBLOCK);
+  if (d_->fd < 0)
+    throw std::runtime_error("Failed to open device node " + node);
+
+  /* evdev stamps events with CLOCK_REALTIME unless told otherwise, which
+   * may jump. Linux 3.4 and later can use CLOCK_MONOTONIC. */
+  int clock = CLOCK_MONOTONIC;
+  d_->clock = ioctl(d_->fd, EVIOCSCLOCKID, &clock) == 0 ? CLOCK_MONOTONIC :
+                                                          CLOCK_REALTIME;
+}
+
+xorg::testing::evemu::EvdevReader::~EvdevReader() {
+  close(d_->fd);
+}
+
+void xorg::testing::evemu::EvdevReader::Inject(int type, int code, int value,
+                                               bool sync) {
+  struct input_event events[2];
+  memset(events, 0, sizeof(events));
+
+  events[0].type = type;
+  events[0].code = code;
+  events[0].value = value;
+  events[1].type = EV_SYN;
+  events[1].code = SYN_REPORT;
+
+  Inject(events, sync ? 2 : 1);
+}
+
+void xorg::testing::evemu::EvdevReader::Inject(const struct input_event *events,
+                                               size_t count) {
+  if (count == 0)
+    return;
+
+  /* PlayFrames() would replace the stats of the last playback */
+  for (size_t i = 0; i < count; i++)
+    d_->device->QueueEvent(events[i].type, events[i].code, events[i].value);
+
+  InjectedEvent injected;
+  injected.sent_ns = clock_ns(d_->clock);
+  d_->device->Flush();
+
+  for (size_t i = 0; i < count; i++) {
+    injected.event = events[i];
+    d_->injected.push_back(injected);
+  }
+}
+
+bool xorg::testing::evemu::EvdevReader::ReadEvents(size_t count,
+                                                   time_t timeout) {
+  uint64_t deadline = clock_ns(CLOCK_MONOTONIC) + timeout * 1000000ULL;
+  struct pollfd pfd;
+  pfd.fd = d_->fd;
+  pfd.events = POLLIN;
+
+  while (d_->events.size() < count) {
+    struct input_event buf[64];
+    ssize_t r = read(d_->fd, buf, sizeof(buf));
+    if (r > 0) {
+      d_->events.insert(d_->events.end(), buf, buf + r / sizeof(buf[0]));
+      continue;
+    }
+    if (r == -1 && errno != EAGAIN && errno != EINTR)
+      return false;
+
+    uint64_t now = clock_ns(CLOCK_MONOTONIC);
+    if (now >= deadline ||
+        poll(&pfd, 1, (deadline - now + 999999) / 1000000) == 0)
+      return false;
+  }
+
+  return true;
+}
+
+const std::vector<struct input_event>&
+xorg::testing::evemu::EvdevReader::GetEvents() const {
+  return d_->events;
+}
+
+bool xorg::testing::evemu::EvdevReader::Verify(std::string *mismatch,
+                                               time_t timeout) {
+  const std::vector<InjectedEvent> &injected = d_->injected;
+  const std::vector<struct input_event> &events = d_->events;
+
+  ReadEvents(injected.size(), timeout);
+
+  memset(&d_->latency, 0, sizeof(d_->latency));
+  double total_us = 0;
+
+  std::stringstream error;
+  size_t n = injected.size() < events.size() ? injected.size() : events.size();
+  for (size_t i = 0; i < n; i++) {
+    const struct input_event &expected = injected[i].event;
+    const struct input_event &ev = events[i];
+
+    if (ev.type != expected.type || ev.code != expected.code ||
+        ev.value != expected.value) {
+      error << "Event " << i << ": expected " << describe_event(expected)
+            << ", got " << describe_event(ev);
+      break;
+    }
+
+    uint64_t kernel_ns = event_ns(ev);
+    double latency_us = kernel_ns > injected[i].sent_ns ?
+                        (kernel_ns - injected[i].sent_ns) / 1000.0 : 0;
+    total_us += latency_us;
+    if (latency_us > d_->latency.max_us)
+      d_->latency.max_us = latency_us;
+    d_->latency.events++;
+  }
+
+  if (d_->latency.events)
+    d_->latency.mean_us = total_us / d_->latency.events;
+
+  if (error.str().empty() && injected.size() != events.size())
+    error << "Expected " << injected.size() << " events, got "
+          << events.size();
+
+  if (mismatch)
+    *mismatch = error.str();
+
+  return error.str().empty();
+}
+
+xorg::testing::evemu::EvdevReader::LatencyStats
+xorg::testing::evemu::EvdevReader::GetLatencyStats() const {
+  return d_->latency;
+}
+
+void xorg::testing::evemu::EvdevReader::Clear() {
+  struct input_event buf[64];
+  while (read(d_->fd, buf, sizeof(buf)) > 0)
+    ;
+
+  d_->injected.clear();
+  d_->events.clear();
+}
@@ -0,0 +1,169 @@
+#
+# Converts an evemu device property file into a C++ header with a static
+# xorg::testing::evemu::DeviceDescriptor, for creating the device without
+# reading or parsing the file at runtime.
+#
+#   awk -f evemu-desc-to-header.awk SynPS2-Synaptics-TouchPad.desc > SynPS2-Synaptics-TouchPad.h
+#
+# The header declares namespace xorg::testing::evemu::descriptors::<name>,
+# with <name> the file name without extension and all characters other
+# than letters and digits replaced by '_'. It contains:
+#   descriptor       the DeviceDescriptor
+#   Has<type, code>  ::value is 1 if the device supports the event, for
+#                    compile-time checks with XORG_GTEST_STATIC_ASSERT
+#
+# Copyright © 2026 xorg-gtest contributors
+#
+# Permission is hereby granted, free of charge, to any person obtaining a copy
+# of this software and associated documentation files (the "Software"), to deal
+# in the Software without restriction, including without limitation the rights
+# to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+# copies of the Software, and to permit persons to whom the Software is
+# furnished to do so, subject to the following conditions:
+#
+# The above copyright notice and this permission notice (including the next
+# paragraph) shall be included in all copies or substantial portions of the
+# Software.
+#
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+# IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+# FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+# AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+# LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+# OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+# SOFTWARE.
+#
+
+function hex(s,    i, c, v) {
+  v = 0
+  s = tolower(s)
+  for (i = 1; i <= length(s); i++) {
+    c = index("0123456789abcdef", substr(s, i, 1))
+    if (c == 0)
+      break
+    v = v * 16 + c - 1
+  }
+  return v
+}
+
+function bit_set(byte, bit) {
+  return int(byte / (2 ^ bit)) % 2
+}
+
+BEGIN {
+  name = ""
+  nprops = 0
+  naxes = 0
+  max_type = -1
+}
+
+/^N:/ {
+  name = substr($0, 4)
+  gsub(/\\/, "\\\\", name)
+  gsub(/"/, "\\\"", name)
+}
+
+/^I:/ {
+  bustype = $2; vendor = $3; product = $4; version = $5
+}
+
+/^P:/ {
+  for (i = 2; i <= NF; i++)
+    props[nprops++] = hex($i)
+}
+
+/^B:/ {
+  type = hex($2)
+  if (!(type in nbits))
+    nbits[type] = 0
+  if (type > max_type)
+    max_type = type
+  for (i = 3; i <= NF; i++)
+    bits[type, nbits[type]++] = hex($i)
+}
+
+/^A:/ {
+  axes[naxes++] = sprintf("{ 0x%02x, %d, %d, %d, %d, %d }", hex($2), $3, $4,
+                          $5, $6, (NF >= 7) ? $7 : 0)
+}
+
+function byte_list(n, type,    i, s) {
+  s = ""
+  for (i = 0; i < n; i++) {
+    if (i % 12 == 0)
+      s = s "\n    "
+    s = s sprintf("0x%02x,", (type < 0) ? props[i] : bits[type, i])
+    if (i % 12 != 11 && i != n - 1)
+      s = s " "
+  }
+  return s
+}
+
+END {
+  file = FILENAME
+  sub(/.*\//, "", file)
+  sub(/\.[^.]*$/, "", file)
+  id = file
+  gsub(/[^A-Za-z0-9]/, "_", id)
+  guard = "XORG_GTEST_DESCRIPTOR_" toupper(id) "_H_"
+
+  print "/* Generated from " file ".desc by evemu-desc-to-header.awk, do not edit */"
+  print ""
+  print "#ifndef " guard
+  print "#define " guard
+  print ""
+  print "#include <xorg/gtest/evemu/xorg-gtest-device.h>"
+  print ""
+  print "namespace xorg {"
+  print "namespace testing {"
+  print "namespace evemu {"
+  print "namespace descriptors {"
+  print "namespace " id " {"
+  print ""
+  print "template <int type, int code> struct Has { enum { value = 0 }; };"
+  for (type = 0; type <= max_type; type++) {
+    if (!(type in nbits))
+      continue
+    for (i = 0; i < nbits[type]; i++)
+      for (b = 0; b < 8; b++)
+        if (bit_set(bits[type, i], b))
+          printf "template <> struct Has<0x%02x, 0x%03x> { enum { value = 1 }; };\n", type, i * 8 + b
+  }
+  print ""
+
+  if (nprops > 0)
+    print "static const unsigned char props[] = {" byte_list(nprops, -1) "\n};"
+  for (type = 0; type <= max_type; type++)
+    if (type in nbits)
+      printf "static const unsigned char bits_%02x[] = {%s\n};\n", type, byte_list(nbits[type], type)
+  if (naxes > 0) {
+    print "static const AbsAxisDescriptor axes[] = {"
+    for (i = 0; i < naxes; i++)
+      print "    " axes[i] ","
+    print "};"
+  }
+  print ""
+
+  print "static const DeviceDescriptor descriptor = {"
+  print "  \"" name "\","
+  printf "  0x%04x, 0x%04x, 0x%04x, 0x%04x,\n", hex(bustype), hex(vendor), hex(product), hex(version)
+  print "  " ((nprops > 0) ? "{ props, sizeof(props) }" : "{ 0, 0 }") ","
+  print "  {"
+  for (type = 0; type <= max_type; type++) {
+    if (type in nbits)
+      printf "    { bits_%02x, sizeof(bits_%02x) },\n", type, type
+    else
+      print "    { 0, 0 },"
+  }
+  print "  },"
+  print "  " ((naxes > 0) ? "axes, sizeof(axes) / sizeof(axes[0])" : "0, 0")
+  print "};"
+  print ""
+  print "} // namespace " id
+  print "} // namespace descriptors"
+  print "} // namespace evemu"
+  print "} // namespace testing"
+  print "} // namespace xorg"
+  print ""
+  print "#endif // " guard
+}
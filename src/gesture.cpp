@@ -0,0 +1,370 @@
+/*******************************************************************************
+ *
+ * X testing environment - multitouch gesture synthesis
+ *
+ * Copyright © 2026 xorg-gtest contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ ******************************************************************************/
+
+
+#include "xorg/gtest/evemu/xorg-gtest-gesture.h"
+
+#include <linux/input.h>
+
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+
+#ifndef BTN_TOOL_QUINTTAP
+#define BTN_TOOL_QUINTTAP 0x148
+#endif
+
+/* distance between fingers side by side, normalized */
+#define FINGER_SPACING 0.1
+
+struct GestureAxis {
+  bool present;
+  int min;
+  int max;
+};
+
+struct xorg::testing::evemu::GestureGenerator::Private {
+  Device *device;
+  unsigned int rate;
+  unsigned int slots;
+  int tracking_id_max;
+  int next_tracking_id;
+  std::vector<int> tracking_ids;
+  GestureAxis x, y, pressure;
+  GestureAxis st_x, st_y, st_pressure;
+  bool has_btn_touch;
+  int tool_codes[6];
+  struct timeval clock;
+  unsigned int max_events;
+  std::vector<struct input_event> events;
+  std::vector<uint32_t> offsets;
+
+  void Add(int type, int code, int value);
+  void EndFrame();
+  void AddTouch(unsigned int fingers, const Trajectory &trajectory,
+                double duration);
+};
+
+void xorg::testing::evemu::GestureGenerator::Private::Add(int type, int code,
+                                                          int value) {
+  if (events.size() >= max_events)
+    throw std::runtime_error("Gesture buffer is full");
+
+  struct input_event ev;
+  ev.time = clock;
+  ev.type = type;
+  ev.code = code;
+  ev.value = value;
+  events.push_back(ev);
+}
+
+void xorg::testing::evemu::GestureGenerator::Private::EndFrame() {
+  Add(EV_SYN, SYN_REPORT, 0);
+  offsets.push_back(events.size());
+
+  clock.tv_usec += 1000000 / rate;
+  while (clock.tv_usec >= 1000000) {
+    clock.tv_sec++;
+    clock.tv_usec -= 1000000;
+  }
+}
+
+static GestureAxis get_gesture_axis(xorg::testing::evemu::Device &device,
+                                    int code) {
+  GestureAxis axis;
+  axis.present = device.GetAbsData(code, &axis.min, &axis.max);
+  return axis;
+}
+
+static int scale_to_axis(const GestureAxis &axis, double value) {
+  if (value < 0)
+    value = 0;
+  else if (value > 1)
+    value = 1;
+  return axis.min + static_cast<int>(floor(value * (axis.max - axis.min) + 0.5));
+}
+
+/* fingers side by side, centered on a point moving along a line */
+class LineTrajectory : public xorg::testing::evemu::GestureGenerator::Trajectory {
+ public:
+  LineTrajectory(unsigned int fingers, double x, double y, double dx, double dy)
+    : fingers_(fingers), x_(x), y_(y), dx_(dx), dy_(dy) {}
+
+  virtual void Position(unsigned int finger, double t, double *x, double *y) const {
+    double offset = (finger - (fingers_ - 1) / 2.0) * FINGER_SPACING;
+    *x = x_ + offset + dx_ * t;
+    *y = y_ + dy_ * t;
+  }
+
+ private:
+  unsigned int fingers_;
+  double x_, y_, dx_, dy_;
+};
+
+/* fingers evenly spread on a circle that grows or shrinks and turns */
+class CircleTrajectory : public xorg::testing::evemu::GestureGenerator::Trajectory {
+ public:
+  CircleTrajectory(unsigned int fingers, double x, double y, double start_radius,
+                   double end_radius, double angle)
+    : fingers_(fingers), x_(x), y_(y), start_radius_(start_radius),
+      end_radius_(end_radius), angle_(angle) {}
+
+  virtual void Position(unsigned int finger, double t, double *x, double *y) const {
+    double a = 2 * M_PI * finger / fingers_ + angle_ * t;
+    double r = start_radius_ + (end_radius_ - start_radius_) * t;
+    *x = x_ + r * cos(a);
+    *y = y_ + r * sin(a);
+  }
+
+ private:
+  unsigned int fingers_;
+  double x_, y_, start_radius_, end_radius_, angle_;
+};
+
+xorg::testing::evemu::GestureGenerator::GestureGenerator(Device &device,
+                                                         unsigned int max_events)
+  : d_(new Private) {
+  d_->device = &device;
+  d_->rate = 100;
+  d_->next_tracking_id = 0;
+  d_->clock.tv_sec = 0;
+  d_->clock.tv_usec = 0;
+  d_->max_events = max_events;
+  d_->events.reserve(max_events);
+  d_->offsets.reserve(max_events + 1);
+  d_->offsets.push_back(0);
+
+  int min, max;
+  if (!device.GetAbsData(ABS_MT_SLOT, &min, &max))
+    throw std::runtime_error("Device does not support ABS_MT_SLOT");
+  d_->slots = max - min + 1;
+  d_->tracking_ids.resize(d_->slots);
+
+  if (!device.GetAbsData(ABS_MT_TRACKING_ID, &min, &d_->tracking_id_max))
+    throw std::runtime_error("Device does not support ABS_MT_TRACKING_ID");
+
+  d_->x = get_gesture_axis(device, ABS_MT_POSITION_X);
+  d_->y = get_gesture_axis(device, ABS_MT_POSITION_Y);
+  if (!d_->x.present || !d_->y.present)
+    throw std::runtime_error("Device does not support ABS_MT_POSITION_X/Y");
+
+  d_->pressure = get_gesture_axis(device, ABS_MT_PRESSURE);
+  d_->st_x = get_gesture_axis(device, ABS_X);
+  d_->st_y = get_gesture_axis(device, ABS_Y);
+  d_->st_pressure = get_gesture_axis(device, ABS_PRESSURE);
+  d_->has_btn_touch = device.HasEvent(EV_KEY, BTN_TOUCH);
+
+  static const int tools[] = { -1, BTN_TOOL_FINGER, BTN_TOOL_DOUBLETAP,
+                               BTN_TOOL_TRIPLETAP, BTN_TOOL_QUADTAP,
+                               BTN_TOOL_QUINTTAP };
+  for (int i = 0; i < 6; i++)
+    d_->tool_codes[i] = (i > 0 && device.HasEvent(EV_KEY, tools[i])) ? tools[i] : -1;
+}
+
+xorg::testing::evemu::GestureGenerator::~GestureGenerator() {}
+
+void xorg::testing::evemu::GestureGenerator::SetSampleRate(unsigned int rate) {
+  if (rate == 0 || rate > 1000000)
+    throw std::runtime_error("Invalid sample rate");
+  d_->rate = rate;
+}
+
+unsigned int xorg::testing::evemu::GestureGenerator::GetSampleRate() const {
+  return d_->rate;
+}
+
+unsigned int xorg::testing::evemu::GestureGenerator::GetSlotCount() const {
+  return d_->slots;
+}
+
+void xorg::testing::evemu::GestureGenerator::Private::AddTouch(
+    unsigned int fingers, const Trajectory &trajectory, double duration) {
+  if (fingers == 0 || fingers > slots)
+    throw std::runtime_error("Device cannot track this many fingers");
+
+  for (unsigned int f = 0; f < fingers; f++) {
+    if (next_tracking_id > tracking_id_max)
+      next_tracking_id = 0;
+    tracking_ids[f] = next_tracking_id++;
+  }
+
+  /* frames may have been dropped by Clear(), always select the first slot */
+  int current_slot = -1;
+
+  int tool = fingers < 6 ? tool_codes[fingers] : -1;
+
+  unsigned int nsamples = static_cast<unsigned int>(duration * rate / 1000 + 0.5);
+  if (nsamples == 0)
+    nsamples = 1;
+
+  for (unsigned int i = 0; i <= nsamples; i++) {
+    double t = static_cast<double>(i) / nsamples;
+
+    for (unsigned int f = 0; f < fingers; f++) {
+      double px, py;
+      trajectory.Position(f, t, &px, &py);
+
+      if (current_slot != static_cast<int>(f)) {
+        Add(EV_ABS, ABS_MT_SLOT, f);
+        current_slot = f;
+      }
+
+      if (i == 0)
+        Add(EV_ABS, ABS_MT_TRACKING_ID, tracking_ids[f]);
+      Add(EV_ABS, ABS_MT_POSITION_X, scale_to_axis(x, px));
+      Add(EV_ABS, ABS_MT_POSITION_Y, scale_to_axis(y, py));
+      if (i == 0 && pressure.present)
+        Add(EV_ABS, ABS_MT_PRESSURE, scale_to_axis(pressure, 0.5));
+
+      /* single-touch emulation follows the first finger */
+      if (f == 0) {
+        if (st_x.present)
+          Add(EV_ABS, ABS_X, scale_to_axis(st_x, px));
+        if (st_y.present)
+          Add(EV_ABS, ABS_Y, scale_to_axis(st_y, py));
+      }
+    }
+
+    if (i == 0) {
+      if (st_pressure.present)
+        Add(EV_ABS, ABS_PRESSURE, scale_to_axis(st_pressure, 0.5));
+      if (has_btn_touch)
+        Add(EV_KEY, BTN_TOUCH, 1);
+      if (tool != -1)
+        Add(EV_KEY, tool, 1);
+    }
+
+    EndFrame();
+  }
+
+  for (unsigned int f = 0; f < fingers; f++) {
+    if (current_slot != static_cast<int>(f)) {
+      Add(EV_ABS, ABS_MT_SLOT, f);
+      current_slot = f;
+    }
+    Add(EV_ABS, ABS_MT_TRACKING_ID, -1);
+  }
+
+  if (st_pressure.present)
+    Add(EV_ABS, ABS_PRESSURE, 0);
+  if (has_btn_touch)
+    Add(EV_KEY, BTN_TOUCH, 0);
+  if (tool != -1)
+    Add(EV_KEY, tool, 0);
+
+  EndFrame();
+}
+
+void xorg::testing::evemu::GestureGenerator::Touch(unsigned int fingers,
+                                                   const Trajectory &trajectory,
+                                                   double duration) {
+  /* a full buffer must not leave touches down without their lift-off */
+  size_t nevents = d_->events.size();
+  size_t noffsets = d_->offsets.size();
+  struct timeval clock = d_->clock;
+  int next_tracking_id = d_->next_tracking_id;
+
+  try {
+    d_->AddTouch(fingers, trajectory, duration);
+  } catch (...) {
+    d_->events.resize(nevents);
+    d_->offsets.resize(noffsets);
+    d_->clock = clock;
+    d_->next_tracking_id = next_tracking_id;
+    throw;
+  }
+}
+
+void xorg::testing::evemu::GestureGenerator::Swipe(unsigned int fingers,
+                                                   double x, double y,
+                                                   double dx, double dy,
+                                                   double duration) {
+  Touch(fingers, LineTrajectory(fingers, x, y, dx, dy), duration);
+}
+
+void xorg::testing::evemu::GestureGenerator::Scroll(double x, double y,
+                                                    double dx, double dy,
+                                                    double duration) {
+  Swipe(2, x, y, dx, dy, duration);
+}
+
+void xorg::testing::evemu::GestureGenerator::Pinch(unsigned int fingers,
+                                                   double x, double y,
+                                                   double start_radius,
+                                                   double end_radius,
+                                                   double duration) {
+  Touch(fingers, CircleTrajectory(fingers, x, y, start_radius, end_radius, 0),
+        duration);
+}
+
+void xorg::testing::evemu::GestureGenerator::Rotate(unsigned int fingers,
+                                                    double x, double y,
+                                                    double radius, double angle,
+                                                    double duration) {
+  Touch(fingers, CircleTrajectory(fingers, x, y, radius, radius, angle),
+        duration);
+}
+
+void xorg::testing::evemu::GestureGenerator::Tap(unsigned int fingers,
+                                                 double x, double y,
+                                                 double duration) {
+  Touch(fingers, LineTrajectory(fingers, x, y, 0, 0), duration);
+}
+
+void xorg::testing::evemu::GestureGenerator::Play(Device::PlaybackMode mode,
+                                                  double factor) const {
+  if (d_->events.empty())
+    return;
+
+  d_->device->PlayFrames(&d_->events[0], &d_->offsets[0], GetFrameCount(),
+                         mode, factor);
+}
+
+const struct input_event*
+xorg::testing::evemu::GestureGenerator::GetEvents() const {
+  return d_->events.empty() ? NULL : &d_->events[0];
+}
+
+unsigned int xorg::testing::evemu::GestureGenerator::GetEventCount() const {
+  return d_->events.size();
+}
+
+const uint32_t* xorg::testing::evemu::GestureGenerator::GetFrameOffsets() const {
+  return &d_->offsets[0];
+}
+
+unsigned int xorg::testing::evemu::GestureGenerator::GetFrameCount() const {
+  return d_->offsets.size() - 1;
+}
+
+void xorg::testing::evemu::GestureGenerator::Clear() {
+  d_->events.clear();
+  d_->offsets.resize(1);
+  d_->clock.tv_sec = 0;
+  d_->clock.tv_usec = 0;
+}
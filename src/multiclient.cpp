@@ -0,0 +1,398 @@
+/*******************************************************************************
+ *
+ * X testing environment - Google Test fixture for many concurrent clients
+ *
+ * Copyright © 2026 xorg-gtest contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ ******************************************************************************/
+
+
+#include "xorg/gtest/xorg-gtest-multiclient.h"
+#include "xorg/gtest/xorg-gtest-xserver.h"
+
+#include <limits.h>
+#include <pthread.h>
+#include <sys/resource.h>
+#include <time.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+
+#include <X11/Xatom.h>
+#include <X11/Xlib.h>
+
+#define CLIENT_THREAD_STACK_SIZE (256 * 1024)
+
+xorg::testing::LatencyHistogram::LatencyHistogram()
+  : count_(0), min_(0), max_(0), sum_(0) {
+  std::fill(buckets_, buckets_ + NUM_BUCKETS, 0);
+}
+
+void xorg::testing::LatencyHistogram::Add(unsigned long usec) {
+  unsigned int bucket = 0;
+  while (bucket < NUM_BUCKETS - 1 && (usec >> (bucket + 1)) != 0)
+    bucket++;
+
+  buckets_[bucket]++;
+  if (count_ == 0 || usec < min_)
+    min_ = usec;
+  if (usec > max_)
+    max_ = usec;
+  count_++;
+  sum_ += usec;
+}
+
+void xorg::testing::LatencyHistogram::Merge(const LatencyHistogram &other) {
+  if (other.count_ == 0)
+    return;
+
+  for (unsigned int i = 0; i < NUM_BUCKETS; i++)
+    buckets_[i] += other.buckets_[i];
+  if (count_ == 0 || other.min_ < min_)
+    min_ = other.min_;
+  if (other.max_ > max_)
+    max_ = other.max_;
+  count_ += other.count_;
+  sum_ += other.sum_;
+}
+
+unsigned long xorg::testing::LatencyHistogram::GetCount() const {
+  return count_;
+}
+
+unsigned long xorg::testing::LatencyHistogram::GetBucket(unsigned int bucket) const {
+  if (bucket >= NUM_BUCKETS)
+    throw std::runtime_error("Invalid histogram bucket");
+  return buckets_[bucket];
+}
+
+unsigned long xorg::testing::LatencyHistogram::GetMin() const {
+  return min_;
+}
+
+unsigned long xorg::testing::LatencyHistogram::GetMax() const {
+  return max_;
+}
+
+double xorg::testing::LatencyHistogram::GetMean() const {
+  return count_ ? static_cast<double>(sum_) / count_ : 0;
+}
+
+unsigned long xorg::testing::LatencyHistogram::GetPercentile(double percentile) const {
+  if (count_ == 0)
+    return 0;
+
+  unsigned long rank = static_cast<unsigned long>(count_ * percentile / 100.0 + 0.5);
+  if (rank < 1)
+    rank = 1;
+
+  unsigned long seen = 0;
+  for (unsigned int i = 0; i < NUM_BUCKETS; i++) {
+    seen += buckets_[i];
+    if (seen >= rank) {
+      unsigned long limit = (2UL << i) - 1;
+      return limit < max_ ? limit : max_;
+    }
+  }
+
+  return max_;
+}
+
+std::ostream& xorg::testing::operator<<(std::ostream &os,
+                                        const LatencyHistogram &histogram) {
+  std::stringstream s;
+  s << histogram.GetCount() << " requests, mean "
+    << std::fixed << std::setprecision(1) << histogram.GetMean() << "us, p50 <= "
+    << histogram.GetPercentile(50) << "us, p99 <= "
+    << histogram.GetPercentile(99) << "us, max "
+    << histogram.GetMax() << "us";
+  return os << s.str();
+}
+
+struct StressClient {
+  ::Display *display;
+  Window window;
+  Atom atom;
+  bool failed;
+  unsigned int seed;
+  xorg::testing::LatencyHistogram latency;
+};
+
+/* Shared by the client threads of one Run() */
+struct StressRun {
+  std::vector<enum xorg::testing::MultiClientTest::Request> mix;
+  unsigned int requests;
+  pthread_mutex_t mutex;
+  pthread_cond_t cond;
+  bool go;
+};
+
+struct StressThread {
+  StressRun *run;
+  StressClient *client;
+};
+
+struct xorg::testing::MultiClientTest::Private {
+  std::vector<StressClient> clients;
+  std::vector<enum Request> mix;
+  xorg::testing::LatencyHistogram connect_latency;
+  unsigned int max_clients;
+};
+
+static unsigned long now_usec() {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return now.tv_sec * 1000000UL + now.tv_nsec / 1000;
+}
+
+/* Each client needs a file descriptor */
+static void raise_fd_limit(rlim_t needed) {
+  struct rlimit limit;
+  if (getrlimit(RLIMIT_NOFILE, &limit) != 0 || limit.rlim_cur >= needed)
+    return;
+
+  limit.rlim_cur = needed < limit.rlim_max ? needed : limit.rlim_max;
+  setrlimit(RLIMIT_NOFILE, &limit);
+}
+
+static void send_request(StressClient *client,
+                         enum xorg::testing::MultiClientTest::Request request) {
+  ::Display *dpy = client->display;
+
+  switch (request) {
+    case xorg::testing::MultiClientTest::REQUEST_SYNC:
+      XSync(dpy, False);
+      break;
+    case xorg::testing::MultiClientTest::REQUEST_INTERN_ATOM:
+      XInternAtom(dpy, "WM_NAME", True);
+      break;
+    case xorg::testing::MultiClientTest::REQUEST_QUERY_POINTER: {
+      Window root, child;
+      int root_x, root_y, win_x, win_y;
+      unsigned int mask;
+      XQueryPointer(dpy, DefaultRootWindow(dpy), &root, &child, &root_x,
+                    &root_y, &win_x, &win_y, &mask);
+      break;
+    }
+    case xorg::testing::MultiClientTest::REQUEST_CHANGE_PROPERTY: {
+      long value = client->seed;
+      XChangeProperty(dpy, client->window, client->atom, XA_INTEGER, 32,
+                      PropModeReplace, reinterpret_cast<unsigned char*>(&value), 1);
+      XSync(dpy, False);
+      break;
+    }
+    case xorg::testing::MultiClientTest::REQUEST_CREATE_WINDOW: {
+      Window window = XCreateSimpleWindow(dpy, DefaultRootWindow(dpy), 0, 0,
+                                          10, 10, 0, 0, 0);
+      XMapWindow(dpy, window);
+      XDestroyWindow(dpy, window);
+      XSync(dpy, False);
+      break;
+    }
+  }
+}
+
+static void* run_client(void *data) {
+  StressThread *thread = static_cast<StressThread*>(data);
+  StressRun *run = thread->run;
+  StressClient *client = thread->client;
+
+  pthread_mutex_lock(&run->mutex);
+  while (!run->go)
+    pthread_cond_wait(&run->cond, &run->mutex);
+  pthread_mutex_unlock(&run->mutex);
+
+  try {
+    for (unsigned int i = 0; i < run->requests; i++) {
+      enum xorg::testing::MultiClientTest::Request request =
+        run->mix[rand_r(&client->seed) % run->mix.size()];
+
+      unsigned long start = now_usec();
+      send_request(client, request);
+      client->latency.Add(now_usec() - start);
+    }
+  } catch (const xorg::testing::XIOError&) {
+    client->failed = true;
+  }
+
+  return NULL;
+}
+
+xorg::testing::MultiClientTest::MultiClientTest() : d_(new Private) {
+  d_->max_clients = 0;
+  XInitThreads();
+}
+
+xorg::testing::MultiClientTest::~MultiClientTest() {}
+
+void xorg::testing::MultiClientTest::TearDown() {
+  /* Xlib cannot close a lost connection without calling the I/O error
+   * handler, those are leaked */
+  for (unsigned int i = 0; i < d_->clients.size(); i++)
+    if (!d_->clients[i].failed)
+      XCloseDisplay(d_->clients[i].display);
+  d_->clients.clear();
+
+  Test::TearDown();
+}
+
+void xorg::testing::MultiClientTest::ConfigureServer(XServer &server) {
+  Test::ConfigureServer(server);
+
+  if (d_->max_clients > 0) {
+    std::stringstream max_clients;
+    max_clients << d_->max_clients;
+    server.SetOption("-maxclients", max_clients.str());
+  }
+}
+
+void xorg::testing::MultiClientTest::SetMaxClients(unsigned int max_clients) {
+  d_->max_clients = max_clients;
+}
+
+void xorg::testing::MultiClientTest::AddRequest(enum Request request,
+                                                unsigned int weight) {
+  d_->mix.insert(d_->mix.end(), weight, request);
+}
+
+unsigned int xorg::testing::MultiClientTest::OpenClients(unsigned int count) {
+  /* room for the connections, stdio, log files and the like */
+  raise_fd_limit(d_->clients.size() + count + 64);
+
+  const char *name = DisplayString(Display());
+  unsigned int opened;
+
+  for (opened = 0; opened < count; opened++) {
+    unsigned long start = now_usec();
+    ::Display *dpy = XOpenDisplay(name);
+    if (!dpy)
+      break;
+    d_->connect_latency.Add(now_usec() - start);
+
+    StressClient client;
+    client.display = dpy;
+    client.window = XCreateSimpleWindow(dpy, DefaultRootWindow(dpy), 0, 0,
+                                        1, 1, 0, 0, 0);
+    client.atom = XInternAtom(dpy, "xorg-gtest stress property", False);
+    client.failed = false;
+    client.seed = d_->clients.size() + 1;
+    d_->clients.push_back(client);
+  }
+
+  return opened;
+}
+
+void xorg::testing::MultiClientTest::Run(unsigned int requests) {
+  StressRun run;
+  run.mix = d_->mix;
+  if (run.mix.empty())
+    run.mix.push_back(REQUEST_SYNC);
+  run.requests = requests;
+  run.go = false;
+  pthread_mutex_init(&run.mutex, NULL);
+  pthread_cond_init(&run.cond, NULL);
+
+  pthread_attr_t attr;
+  pthread_attr_init(&attr);
+  size_t stack_size = CLIENT_THREAD_STACK_SIZE;
+  if (stack_size < static_cast<size_t>(PTHREAD_STACK_MIN))
+    stack_size = PTHREAD_STACK_MIN;
+  pthread_attr_setstacksize(&attr, stack_size);
+
+  std::vector<StressThread> threads;
+  std::vector<pthread_t> ids;
+  threads.reserve(d_->clients.size());
+
+  bool create_failed = false;
+  for (unsigned int i = 0; i < d_->clients.size(); i++) {
+    if (d_->clients[i].failed)
+      continue;
+
+    StressThread thread = { &run, &d_->clients[i] };
+    threads.push_back(thread);
+
+    pthread_t id;
+    if (pthread_create(&id, &attr, run_client, &threads.back()) != 0) {
+      create_failed = true;
+      break;
+    }
+    ids.push_back(id);
+  }
+  pthread_attr_destroy(&attr);
+
+  /* start all at once, or let those created finish if we cannot */
+  pthread_mutex_lock(&run.mutex);
+  run.go = true;
+  pthread_cond_broadcast(&run.cond);
+  pthread_mutex_unlock(&run.mutex);
+
+  for (unsigned int i = 0; i < ids.size(); i++)
+    pthread_join(ids[i], NULL);
+
+  pthread_cond_destroy(&run.cond);
+  pthread_mutex_destroy(&run.mutex);
+
+  if (create_failed)
+    throw std::runtime_error("Failed to create client thread");
+}
+
+unsigned int xorg::testing::MultiClientTest::GetClientCount() const {
+  return d_->clients.size();
+}
+
+unsigned int xorg::testing::MultiClientTest::GetFailedClients() const {
+  unsigned int failed = 0;
+  for (unsigned int i = 0; i < d_->clients.size(); i++)
+    if (d_->clients[i].failed)
+      failed++;
+  return failed;
+}
+
+::Display* xorg::testing::MultiClientTest::Client(unsigned int index) const {
+  if (index >= d_->clients.size())
+    throw std::runtime_error("Invalid client index");
+  return d_->clients[index].display;
+}
+
+const xorg::testing::LatencyHistogram&
+xorg::testing::MultiClientTest::GetLatency(unsigned int index) const {
+  if (index >= d_->clients.size())
+    throw std::runtime_error("Invalid client index");
+  return d_->clients[index].latency;
+}
+
+xorg::testing::LatencyHistogram
+xorg::testing::MultiClientTest::GetTotalLatency() const {
+  LatencyHistogram total;
+  for (unsigned int i = 0; i < d_->clients.size(); i++)
+    total.Merge(d_->clients[i].latency);
+  return total;
+}
+
+const xorg::testing::LatencyHistogram&
+xorg::testing::MultiClientTest::GetConnectLatency() const {
+  return d_->connect_latency;
+}
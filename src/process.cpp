@@ -59,6 +59,9 @@ enum xorg::testing::Process::State xorg::testing::Process::GetState() {
       if (WIFEXITED(status)) {
         d_->pid = -1;
         d_->state = WEXITSTATUS(status) ? FINISHED_FAILURE : FINISHED_SUCCESS;
+      } else if (WIFSIGNALED(status)) {
+        d_->pid = -1;
+        d_->state = FINISHED_FAILURE;
       }
     }
   }
@@ -27,29 +27,311 @@
  ******************************************************************************/
 
 #include "xorg/gtest/xorg-gtest-test.h"
+#include "xorg/gtest/xorg-gtest-displaycache.h"
+#include "xorg/gtest/xorg-gtest-environment.h"
+#include "xorg/gtest/xorg-gtest-xserver.h"
 
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <iostream>
+#include <map>
+#include <sstream>
 #include <stdexcept>
+#include <vector>
 
 #include <X11/Xlib.h>
+#include <X11/Xlibint.h>
+#include <X11/extensions/XInput2.h>
+#include <X11/extensions/XRes.h>
+
+#include "defines.h"
+
+/* The server shared by the tests of a test case with SCOPE_PER_SUITE */
+static std::auto_ptr<xorg::testing::XServer> suite_server;
+static std::string suite_server_test_case;
+
+/* Idle connections by display name */
+static std::map<std::string, std::vector< ::Display*> > connection_pool;
+
+/* Server resources of all clients */
+struct ResourceSnapshot {
+  int nclients;
+  std::map<Atom, long> counts;
+  unsigned long pixmap_bytes;
+};
 
 struct xorg::testing::Test::Private {
   ::Display* display;
   std::string display_string;
+  std::string display_name;
+  enum ServerScope scope;
+  std::auto_ptr<XServer> server;
+  bool pool;
+  bool prewarm;
+  enum LeakCheck leak_check;
+  ::Display *monitor;
+  ResourceSnapshot resources;
 };
 
 xorg::testing::Test::Test() : d_(new Private) {
   d_->display = NULL;
+  d_->scope = SCOPE_GLOBAL;
+  d_->pool = false;
+  d_->prewarm = false;
+  d_->leak_check = LEAK_CHECK_NONE;
+  d_->monitor = NULL;
+}
+
+static void take_resource_snapshot(::Display *dpy, ResourceSnapshot *snapshot) {
+  XResClient *clients;
+  if (!XResQueryClients(dpy, &snapshot->nclients, &clients))
+    throw std::runtime_error("Failed to query clients");
+
+  snapshot->counts.clear();
+  snapshot->pixmap_bytes = 0;
+
+  for (int i = 0; i < snapshot->nclients; i++) {
+    int ntypes;
+    XResType *types;
+    if (XResQueryClientResources(dpy, clients[i].resource_base, &ntypes, &types)) {
+      for (int j = 0; j < ntypes; j++)
+        snapshot->counts[types[j].resource_type] += types[j].count;
+      XFree(types);
+    }
+
+    unsigned long bytes;
+    if (XResQueryClientPixmapBytes(dpy, clients[i].resource_base, &bytes))
+      snapshot->pixmap_bytes += bytes;
+  }
+
+  XFree(clients);
+}
+
+static long resource_count(const ResourceSnapshot &snapshot, Atom type) {
+  std::map<Atom, long>::const_iterator it = snapshot.counts.find(type);
+  return it == snapshot.counts.end() ? 0 : it->second;
+}
+
+/* Returns a description of the windows, pixmaps and pixmap bytes that grew
+ * since the baseline, or an empty string. Other types that grew are
+ * listed too if one of these did. */
+static std::string resource_growth(::Display *dpy, const ResourceSnapshot &baseline,
+                                   const ResourceSnapshot &current) {
+  Atom window = xorg::testing::DisplayCache::GetAtom(dpy, "WINDOW");
+  Atom pixmap = xorg::testing::DisplayCache::GetAtom(dpy, "PIXMAP");
+
+  if (resource_count(current, window) <= resource_count(baseline, window) &&
+      resource_count(current, pixmap) <= resource_count(baseline, pixmap) &&
+      current.pixmap_bytes <= baseline.pixmap_bytes)
+    return "";
+
+  std::stringstream growth;
+  std::map<Atom, long>::const_iterator it;
+  for (it = current.counts.begin(); it != current.counts.end(); it++) {
+    long diff = it->second - resource_count(baseline, it->first);
+    if (diff <= 0)
+      continue;
+
+    growth << xorg::testing::DisplayCache::GetAtomName(dpy, it->first)
+           << " +" << diff << ", ";
+  }
+  growth << "pixmap bytes +"
+         << static_cast<long>(current.pixmap_bytes - baseline.pixmap_bytes);
+
+  return growth.str();
+}
+
+static bool client_exists(::Display *dpy, XID resource_base) {
+  int nclients;
+  XResClient *clients;
+  if (!XResQueryClients(dpy, &nclients, &clients))
+    throw std::runtime_error("Failed to query clients");
+
+  bool found = false;
+  for (int i = 0; i < nclients && !found; i++)
+    found = (clients[i].resource_base == resource_base);
+
+  XFree(clients);
+  return found;
+}
+
+/* Closing a connection is asynchronous on the server side, wait for the
+ * client with the given resource base to be cleaned up before taking the
+ * snapshot. Other clients coming and going do not matter. */
+static void wait_for_client_gone(::Display *dpy, XID resource_base,
+                                 ResourceSnapshot *snapshot) {
+  struct timespec delay = { 0, 5000000L };
+
+  for (int i = 0; resource_base != 0 && i < 200; i++) {
+    if (!client_exists(dpy, resource_base))
+      break;
+    nanosleep(&delay, NULL);
+  }
+
+  take_resource_snapshot(dpy, snapshot);
+}
+
+/* false if the server closed the connection, e.g. because it was killed
+ * by a reset or the server died */
+static bool connection_alive(::Display *dpy) {
+  if (dpy->flags & XlibDisplayIOError)
+    return false;
+
+  char c;
+  ssize_t len = recv(ConnectionNumber(dpy), &c, 1, MSG_PEEK | MSG_DONTWAIT);
+  return len > 0 || (len == -1 && (errno == EAGAIN || errno == EWOULDBLOCK));
+}
+
+static void close_connection(::Display *dpy) {
+  /* XCloseDisplay() would try to sync with the server and end up in the
+   * I/O error handler */
+  if (!connection_alive(dpy))
+    dpy->flags |= XlibDisplayIOError;
+  XCloseDisplay(dpy);
+}
+
+static int ignore_error_handler(::Display *dpy, XErrorEvent *error) {
+  return 0;
+}
+
+/* Undo what a test may have done on this connection that affects the
+ * next test: event selections on the root window, grabs, top-level
+ * windows created, pending events and errors. Other resources the test
+ * created are not freed. Returns false if the connection is dead. */
+static bool reset_connection(::Display *dpy) {
+  if (!connection_alive(dpy))
+    return false;
+
+  XErrorHandler old_handler = XSetErrorHandler(ignore_error_handler);
+  Window root = DefaultRootWindow(dpy);
+
+  try {
+    XSelectInput(dpy, root, NoEventMask);
+
+    XIEventMask mask;
+    mask.mask_len = 0;
+    mask.mask = NULL;
+    mask.deviceid = XIAllDevices;
+    XISelectEvents(dpy, root, &mask, 1);
+    mask.deviceid = XIAllMasterDevices;
+    XISelectEvents(dpy, root, &mask, 1);
+
+    XUngrabPointer(dpy, CurrentTime);
+    XUngrabKeyboard(dpy, CurrentTime);
+    XUngrabServer(dpy);
+    XUngrabButton(dpy, AnyButton, AnyModifier, root);
+    XUngrabKey(dpy, AnyKey, AnyModifier, root);
+
+    Window parent, *children;
+    unsigned int nchildren;
+    if (XQueryTree(dpy, root, &root, &parent, &children, &nchildren)) {
+      for (unsigned int i = 0; i < nchildren; i++)
+        if ((children[i] & ~dpy->resource_mask) == dpy->resource_base)
+          XDestroyWindow(dpy, children[i]);
+      XFree(children);
+    }
+
+    XSync(dpy, True);
+  } catch (const xorg::testing::XIOError&) {
+    XSetErrorHandler(old_handler);
+    return false;
+  }
+
+  XSetErrorHandler(old_handler);
+  return true;
+}
+
+static ::Display* take_pooled_connection(const std::string &name) {
+  std::vector< ::Display*> &idle = connection_pool[name];
+
+  while (!idle.empty()) {
+    ::Display *dpy = idle.back();
+    idle.pop_back();
+
+    if (connection_alive(dpy)) {
+      /* events that arrived while the connection was idle */
+      XSync(dpy, True);
+      return dpy;
+    }
+    close_connection(dpy);
+  }
+
+  return NULL;
 }
 
 xorg::testing::Test::~Test() {}
 
+/* The first display after the environment's without a server, judged by
+ * its lock file and socket. The environment's extra servers and servers
+ * of other processes are running by the time a fixture starts its own. */
+static unsigned int free_display_number() {
+  for (unsigned int display = DEFAULT_DISPLAY + 1; display < DEFAULT_DISPLAY + 64; display++) {
+    std::stringstream lock_file, socket;
+    lock_file << "/tmp/.X" << display << "-lock";
+    socket << X11_SOCKET_DIR << "/X" << display;
+    if (access(lock_file.str().c_str(), F_OK) != 0 &&
+        access(socket.str().c_str(), F_OK) != 0)
+      return display;
+  }
+
+  throw std::runtime_error("No free display for the fixture's server");
+}
+
+/* A server for a fixture with its own server scope, name is the test
+ * case name or the test case and test name */
+static xorg::testing::XServer* new_server(std::string name) {
+  /* parameterized tests are named e.g. Foo/0 */
+  std::replace(name.begin(), name.end(), '/', '_');
+
+  std::auto_ptr<xorg::testing::XServer> server(new xorg::testing::XServer);
+  server->SetDisplayNumber(free_display_number());
+  server->SetOption("-config", DUMMY_CONF_PATH);
+  server->SetOption("-logfile", LOGFILE_DIR "/Xorg.GTest." + name + ".log");
+  server->SetOption("-noreset");
+  return server.release();
+}
+
 void xorg::testing::Test::SetUp() {
   const char *dpy = NULL;
+  const ::testing::TestInfo *test_info =
+    ::testing::UnitTest::GetInstance()->current_test_info();
 
-  if (!d_->display_string.empty())
+  if (!d_->display_string.empty()) {
     dpy = d_->display_string.c_str();
+  } else if (d_->scope == SCOPE_PER_TEST) {
+    std::stringstream name;
+    name << test_info->test_case_name() << "." << test_info->name();
+    d_->server.reset(new_server(name.str()));
+    ConfigureServer(*d_->server);
+    d_->server->Start();
+    dpy = d_->server->GetDisplayString().c_str();
+  } else if (d_->scope == SCOPE_PER_SUITE) {
+    /* in case a fixture's TearDownTestCase() didn't call ours */
+    if (suite_server.get() && suite_server_test_case != test_info->test_case_name())
+      TearDownTestCase();
 
-  d_->display = XOpenDisplay(dpy);
+    if (!suite_server.get()) {
+      std::auto_ptr<XServer> server(new_server(test_info->test_case_name()));
+      ConfigureServer(*server);
+      server->Start();
+      suite_server = server;
+      suite_server_test_case = test_info->test_case_name();
+    }
+    dpy = suite_server->GetDisplayString().c_str();
+  } else {
+    Environment::RequireServer();
+  }
+
+  d_->display_name = XDisplayName(dpy);
+  if (d_->pool)
+    d_->display = take_pooled_connection(d_->display_name);
+  if (!d_->display)
+    d_->display = XOpenDisplay(dpy);
   if (!d_->display) {
     std::stringstream ss;
     ss << "Failed to open connection to display";
@@ -59,12 +341,70 @@ void xorg::testing::Test::SetUp() {
           "error messages when starting.";
     throw std::runtime_error(ss.str());
   }
+
+  if (d_->leak_check != LEAK_CHECK_NONE) {
+    d_->monitor = XOpenDisplay(dpy);
+    int event_base, error_base;
+    if (!d_->monitor || !XResQueryExtension(d_->monitor, &event_base, &error_base)) {
+      if (d_->monitor)
+        XCloseDisplay(d_->monitor);
+      d_->monitor = NULL;
+      throw std::runtime_error("Leak checks require the X-Resource extension");
+    }
+    take_resource_snapshot(d_->monitor, &d_->resources);
+  }
+}
+
+void xorg::testing::Test::CheckResources(XID closed_client) {
+  ResourceSnapshot current;
+  wait_for_client_gone(d_->monitor, closed_client, &current);
+
+  std::string growth = resource_growth(d_->monitor, d_->resources, current);
+  if (growth.empty())
+    return;
+
+  if (d_->leak_check == LEAK_CHECK_FAIL) {
+    ADD_FAILURE() << "Server resources grew during the test: " << growth;
+  } else {
+    std::cout << "[  LEAKS   ] Server resources grew during the test: "
+              << growth << "\n";
+    RecordProperty("resource_growth", growth.c_str());
+  }
 }
 
 void xorg::testing::Test::TearDown() {
-  if (d_->display)
-    XCloseDisplay(d_->display);
+  XID closed_client = 0;
+
+  if (d_->display) {
+    if (d_->pool && reset_connection(d_->display)) {
+      connection_pool[d_->display_name].push_back(d_->display);
+    } else {
+      closed_client = d_->display->resource_base;
+      close_connection(d_->display);
+    }
+  }
   d_->display = NULL;
+
+  if (d_->monitor) {
+    CheckResources(closed_client);
+    XCloseDisplay(d_->monitor);
+    d_->monitor = NULL;
+  }
+
+  if (d_->pool && d_->prewarm && connection_pool[d_->display_name].empty()) {
+    ::Display *spare = XOpenDisplay(d_->display_name.c_str());
+    if (spare)
+      connection_pool[d_->display_name].push_back(spare);
+  }
+
+  /* the destructor terminates the server */
+  d_->server.reset();
+}
+
+void xorg::testing::Test::TearDownTestCase() {
+  /* the destructor terminates the server */
+  suite_server.reset();
+  suite_server_test_case.clear();
 }
 
 ::Display* xorg::testing::Test::Display() const {
@@ -74,3 +414,27 @@ void xorg::testing::Test::TearDown() {
 void xorg::testing::Test::SetDisplayString(const std::string &display) {
   d_->display_string = display;
 }
+
+void xorg::testing::Test::SetServerScope(enum ServerScope scope) {
+  d_->scope = scope;
+}
+
+void xorg::testing::Test::ConfigureServer(XServer &server) {
+}
+
+void xorg::testing::Test::SetLeakCheck(enum LeakCheck check) {
+  d_->leak_check = check;
+}
+
+void xorg::testing::Test::SetConnectionPooling(bool pool, bool prewarm) {
+  d_->pool = pool;
+  d_->prewarm = prewarm;
+}
+
+xorg::testing::XServer* xorg::testing::Test::Server() const {
+  if (d_->server.get())
+    return d_->server.get();
+  else if (d_->scope == SCOPE_PER_SUITE)
+    return suite_server.get();
+  return NULL;
+}
@@ -29,7 +29,15 @@
 #include "src/process.cpp"
 #include "src/xserver.cpp"
 #include "src/test.cpp"
+#include "src/displaycache.cpp"
+#include "src/deviceproperties.cpp"
+#include "src/multiclient.cpp"
+#include "src/xorgconfig.cpp"
 
 #ifdef HAVE_EVEMU
 #include "src/device.cpp"
+#include "src/gesture.cpp"
+#include "src/capabilities.cpp"
+#include "src/devicepool.cpp"
+#include "src/evdevreader.cpp"
 #endif
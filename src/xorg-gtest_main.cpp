@@ -28,10 +28,12 @@
 #include <getopt.h>
 
 #include <csignal>
+#include <cstring>
 
 #include <gtest/gtest.h>
 
 #include "xorg/gtest/xorg-gtest-environment.h"
+#include "xorg/gtest/xorg-gtest-xserver.h"
 #include "defines.h"
 
 namespace {
@@ -42,6 +44,9 @@ int xorg_conf_specified = false;
 int xorg_display_specified = false;
 int xorg_logfile_specified = false;
 int server_specified = false;
+int xorg_isolate = false;
+int xorg_reset_specified = false;
+int xorg_lazy = false;
 
 const struct option longopts[] = {
   { "help", no_argument, &help, true, },
@@ -50,6 +55,9 @@ const struct option longopts[] = {
   { "xorg-display", required_argument, &xorg_display_specified, true, },
   { "xorg-logfile", required_argument, &xorg_logfile_specified, true, },
   { "server", required_argument, &server_specified, true, },
+  { "xorg-isolate", no_argument, &xorg_isolate, true, },
+  { "xorg-reset", required_argument, &xorg_reset_specified, true, },
+  { "xorg-lazy", no_argument, &xorg_lazy, true, },
   { NULL, 0, NULL, 0 }
 };
 
@@ -113,6 +121,12 @@ static int usage(int exitcode) {
   std::cout << "    --xorg-display: xorg display port\n";
   std::cout << "    --xorg-logfile: xorg logfile filename. See -logfile in \"man Xorg\".\n"
                "                    Its default value is " DEFAULT_XORG_LOGFILE ".\n";
+  std::cout << "    --xorg-isolate: run the server in private user, mount and network\n"
+               "                    namespaces with a private /tmp.\n";
+  std::cout << "    --xorg-reset: how to reset the server between tests, one of\n"
+               "                  \"none\" (default), \"clients\", \"regenerate\"\n"
+               "                  or \"restart\".\n";
+  std::cout << "    --xorg-lazy: only start the server once the first test needs it.\n";
   return exitcode;
 }
 
@@ -121,6 +135,8 @@ int main(int argc, char *argv[]) {
   std::string xorg_log_file_path;
   int xorg_display = -1;
   std::string server;
+  xorg::testing::Environment::ResetMode xorg_reset =
+    xorg::testing::Environment::RESET_NONE;
 
   setup_signal_handlers();
 
@@ -157,6 +173,19 @@ int main(int argc, char *argv[]) {
         server = optarg;
         break;
 
+      case 7:
+        if (strcmp(optarg, "none") == 0)
+          xorg_reset = xorg::testing::Environment::RESET_NONE;
+        else if (strcmp(optarg, "clients") == 0)
+          xorg_reset = xorg::testing::Environment::RESET_CLIENTS;
+        else if (strcmp(optarg, "regenerate") == 0)
+          xorg_reset = xorg::testing::Environment::RESET_REGENERATE;
+        else if (strcmp(optarg, "restart") == 0)
+          xorg_reset = xorg::testing::Environment::RESET_RESTART;
+        else
+          return usage(-1);
+        break;
+
       default:
         break;
     }
@@ -165,6 +194,15 @@ int main(int argc, char *argv[]) {
   if (help)
     return usage(-1);
 
+  if (xorg_isolate) {
+    try {
+      xorg::testing::XServer::Isolate(xorg::testing::XServer::ISOLATION_NETWORK);
+    } catch (const std::runtime_error &e) {
+      std::cerr << e.what() << "\n";
+      return -1;
+    }
+  }
+
   if (!no_dummy_server) {
     environment = new xorg::testing::Environment;
 
@@ -180,6 +218,9 @@ int main(int argc, char *argv[]) {
     if (xorg_logfile_specified)
       environment->SetLogFile(xorg_log_file_path);
 
+    environment->SetResetMode(xorg_reset);
+    environment->SetLazyStart(xorg_lazy);
+
     testing::AddGlobalTestEnvironment(environment);
   }
 
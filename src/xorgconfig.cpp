@@ -0,0 +1,339 @@
+/*******************************************************************************
+ *
+ * X testing environment - Google Test helper class to generate server configurations
+ *
+ * Copyright © 2026 xorg-gtest contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ ******************************************************************************/
+
+#include "xorg/gtest/xorg-gtest-xorgconfig.h"
+#include "defines.h"
+
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <set>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+
+struct InputDeviceSection {
+  std::string identifier;
+  std::string driver;
+  std::map<std::string, std::string> options;
+};
+
+struct xorg::testing::XorgConfig::Private {
+  std::map<std::string, std::string> server_flags;
+  std::set<std::string> modules;
+  std::set<std::string> disabled_modules;
+  std::map<std::string, bool> extensions;
+  std::vector<InputDeviceSection> input_devices;
+  std::vector<std::string> font_paths;
+  std::string path;
+};
+
+/* Extensions a test of the input stack or the core protocol usually has no
+ * use for, but that take time to initialize */
+static const char *minimal_disabled_extensions[] = {
+  "Composite",
+  "DOUBLE-BUFFER",
+  "DPMS",
+  "GLX",
+  "MIT-SCREEN-SAVER",
+  "XFree86-DGA",
+  "XFree86-VidModeExtension",
+  "XVideo",
+  "XVideo-MotionCompensation",
+};
+
+xorg::testing::XorgConfig::XorgConfig(enum Profile profile) : d_(new Private) {
+  if (profile == PROFILE_MINIMAL) {
+    SetAutoAddDevices(false);
+    SetServerFlag("AutoAddGPU", "off");
+    DisableModule("glx");
+    d_->font_paths.push_back("built-ins");
+
+    for (unsigned int i = 0;
+         i < sizeof(minimal_disabled_extensions)/sizeof(minimal_disabled_extensions[0]);
+         i++)
+      SetExtension(minimal_disabled_extensions[i], false);
+  }
+}
+
+xorg::testing::XorgConfig::~XorgConfig() {}
+
+void xorg::testing::XorgConfig::LoadModule(const std::string &module) {
+  d_->disabled_modules.erase(module);
+  d_->modules.insert(module);
+}
+
+void xorg::testing::XorgConfig::DisableModule(const std::string &module) {
+  d_->modules.erase(module);
+  d_->disabled_modules.insert(module);
+}
+
+void xorg::testing::XorgConfig::SetExtension(const std::string &extension,
+                                             bool enabled) {
+  d_->extensions[extension] = enabled;
+}
+
+void xorg::testing::XorgConfig::SetServerFlag(const std::string &option,
+                                              const std::string &value) {
+  d_->server_flags[option] = value;
+}
+
+void xorg::testing::XorgConfig::SetAutoAddDevices(bool enabled) {
+  SetServerFlag("AutoAddDevices", enabled ? "on" : "off");
+}
+
+void xorg::testing::XorgConfig::AddInputDevice(const std::string &identifier,
+                                               const std::string &driver) {
+  std::vector<InputDeviceSection>::iterator it;
+  for (it = d_->input_devices.begin(); it != d_->input_devices.end(); it++) {
+    if (it->identifier == identifier) {
+      it->driver = driver;
+      return;
+    }
+  }
+
+  InputDeviceSection section;
+  section.identifier = identifier;
+  section.driver = driver;
+  d_->input_devices.push_back(section);
+}
+
+void xorg::testing::XorgConfig::SetInputDeviceOption(const std::string &identifier,
+                                                     const std::string &option,
+                                                     const std::string &value) {
+  std::vector<InputDeviceSection>::iterator it;
+  for (it = d_->input_devices.begin(); it != d_->input_devices.end(); it++) {
+    if (it->identifier == identifier) {
+      it->options[option] = value;
+      return;
+    }
+  }
+
+  throw std::runtime_error("Unknown input device " + identifier);
+}
+
+static void write_option(std::stringstream &s, const std::string &option,
+                         const std::string &value) {
+  s << "    Option \"" << option << "\" \"" << value << "\"\n";
+}
+
+std::string xorg::testing::XorgConfig::GetContents() const {
+  std::stringstream s;
+
+  if (!d_->server_flags.empty()) {
+    std::map<std::string, std::string>::const_iterator it;
+
+    s << "Section \"ServerFlags\"\n";
+    for (it = d_->server_flags.begin(); it != d_->server_flags.end(); it++)
+      write_option(s, it->first, it->second);
+    s << "EndSection\n\n";
+  }
+
+  if (!d_->font_paths.empty()) {
+    std::vector<std::string>::const_iterator it;
+
+    s << "Section \"Files\"\n";
+    for (it = d_->font_paths.begin(); it != d_->font_paths.end(); it++)
+      s << "    FontPath \"" << *it << "\"\n";
+    s << "EndSection\n\n";
+  }
+
+  if (!d_->modules.empty() || !d_->disabled_modules.empty()) {
+    std::set<std::string>::const_iterator it;
+
+    s << "Section \"Module\"\n";
+    for (it = d_->modules.begin(); it != d_->modules.end(); it++)
+      s << "    Load \"" << *it << "\"\n";
+    for (it = d_->disabled_modules.begin(); it != d_->disabled_modules.end(); it++)
+      s << "    Disable \"" << *it << "\"\n";
+    s << "EndSection\n\n";
+  }
+
+  if (!d_->extensions.empty()) {
+    std::map<std::string, bool>::const_iterator it;
+
+    s << "Section \"Extensions\"\n";
+    for (it = d_->extensions.begin(); it != d_->extensions.end(); it++)
+      write_option(s, it->first, it->second ? "Enable" : "Disable");
+    s << "EndSection\n\n";
+  }
+
+  std::vector<InputDeviceSection>::const_iterator dev;
+
+  for (dev = d_->input_devices.begin(); dev != d_->input_devices.end(); dev++) {
+    std::map<std::string, std::string>::const_iterator it;
+
+    s << "Section \"InputDevice\"\n";
+    s << "    Identifier \"" << dev->identifier << "\"\n";
+    s << "    Driver \"" << dev->driver << "\"\n";
+    for (it = dev->options.begin(); it != dev->options.end(); it++)
+      write_option(s, it->first, it->second);
+    s << "EndSection\n\n";
+  }
+
+  s << "Section \"ServerLayout\"\n";
+  s << "    Identifier \"Dummy layout\"\n";
+  s << "    Screen 0 \"Dummy screen\" 0 0\n";
+  for (dev = d_->input_devices.begin(); dev != d_->input_devices.end(); dev++)
+    s << "    InputDevice \"" << dev->identifier << "\"\n";
+  s << "EndSection\n\n";
+
+  s << "Section \"Screen\"\n";
+  s << "    Identifier \"Dummy screen\"\n";
+  s << "    Device \"Dummy video device\"\n";
+  s << "EndSection\n\n";
+
+  s << "Section \"Device\"\n";
+  s << "    Identifier \"Dummy video device\"\n";
+  s << "    Driver \"dummy\"\n";
+  s << "EndSection\n";
+
+  return s.str();
+}
+
+/* 64-bit FNV-1a, good enough to tell configurations apart */
+static std::string hash_contents(const std::string &contents) {
+  unsigned long long hash = 0xcbf29ce484222325ULL;
+
+  for (std::string::const_iterator it = contents.begin(); it != contents.end(); it++) {
+    hash ^= static_cast<unsigned char>(*it);
+    hash *= 0x100000001b3ULL;
+  }
+
+  char buf[17];
+  snprintf(buf, sizeof(buf), "%016llx", hash);
+  return std::string(buf);
+}
+
+/* A directory only we can write to */
+static bool is_private_dir(const std::string &dir) {
+  struct stat st;
+  return lstat(dir.c_str(), &st) == 0 && S_ISDIR(st.st_mode) &&
+         st.st_uid == geteuid() && (st.st_mode & 077) == 0;
+}
+
+/* The server runs as root and loads modules named in its config, so the
+ * default directory must not be shared with other users. Use
+ * <base>/xorg-gtest-<uid>, or a fresh directory if someone else got to
+ * that name first. */
+static std::string private_config_dir() {
+  static std::string dir;
+  if (!dir.empty())
+    return dir;
+
+  std::string base = (access(DEFAULT_XORG_CONFIG_DIR, W_OK) == 0) ?
+                     DEFAULT_XORG_CONFIG_DIR : LOGFILE_DIR;
+
+  std::stringstream s;
+  s << base << "/xorg-gtest-" << geteuid();
+  mkdir(s.str().c_str(), 0700);
+  if (is_private_dir(s.str())) {
+    dir = s.str();
+    return dir;
+  }
+
+  std::string tmpl = base + "/xorg-gtest-XXXXXX";
+  std::vector<char> buf(tmpl.begin(), tmpl.end());
+  buf.push_back('\0');
+  if (!mkdtemp(&buf[0]))
+    throw std::runtime_error("Failed to create config directory in " + base +
+                             ": " + std::strerror(errno));
+  dir = &buf[0];
+  return dir;
+}
+
+/* true if path is a regular file of ours, not writable by others, with
+ * exactly these contents */
+static bool is_trusted_file(const std::string &path, const std::string &contents) {
+  int fd = open(path.c_str(), O_RDONLY | O_NOFOLLOW);
+  if (fd == -1)
+    return false;
+
+  struct stat st;
+  bool trusted = fstat(fd, &st) == 0 && S_ISREG(st.st_mode) &&
+                 st.st_uid == geteuid() && (st.st_mode & 022) == 0 &&
+                 st.st_size == static_cast<off_t>(contents.size());
+
+  if (trusted) {
+    std::string text(contents.size(), '\0');
+    trusted = read(fd, &text[0], text.size()) == static_cast<ssize_t>(text.size()) &&
+              text == contents;
+  }
+
+  close(fd);
+  return trusted;
+}
+
+const std::string& xorg::testing::XorgConfig::WriteConfig(const std::string &directory) {
+  std::string dir = directory.empty() ? private_config_dir() : directory;
+
+  std::string contents = GetContents();
+  std::string path = dir + "/xorg-gtest-" + hash_contents(contents) + ".conf";
+
+  /* Same name means same contents, unless someone else wrote it */
+  if (is_trusted_file(path, contents)) {
+    d_->path = path;
+    return d_->path;
+  }
+
+  /* Write to a new temporary file and rename it, so a concurrent server
+   * never sees a partially written configuration */
+  std::string tmp = path + ".XXXXXX";
+  std::vector<char> tmpl(tmp.begin(), tmp.end());
+  tmpl.push_back('\0');
+
+  /* mkstemp creates the file with O_EXCL and mode 0600 */
+  int fd = mkstemp(&tmpl[0]);
+  if (fd == -1)
+    throw std::runtime_error("Failed to write config file " + tmp);
+  tmp = &tmpl[0];
+
+  ssize_t len = write(fd, contents.data(), contents.size());
+  if (close(fd) != 0 || len != static_cast<ssize_t>(contents.size())) {
+    unlink(tmp.c_str());
+    throw std::runtime_error("Failed to write config file " + tmp);
+  }
+
+  if (rename(tmp.c_str(), path.c_str()) != 0) {
+    unlink(tmp.c_str());
+    throw std::runtime_error("Failed to write config file " + path);
+  }
+
+  d_->path = path;
+  return d_->path;
+}
+
+const std::string& xorg::testing::XorgConfig::GetConfigPath() const {
+  return d_->path;
+}
@@ -27,10 +27,19 @@
  ******************************************************************************/
 
 #include "xorg/gtest/xorg-gtest-xserver.h"
+#include "xorg/gtest/xorg-gtest-displaycache.h"
 #include "defines.h"
 
+#include <sys/mount.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
 #include <sys/types.h>
+#include <sys/un.h>
 #include <sys/wait.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sched.h>
 #include <unistd.h>
 
 #include <algorithm>
@@ -39,6 +48,7 @@
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
+#include <ctime>
 #include <stdexcept>
 #include <vector>
 #include <map>
@@ -47,11 +57,14 @@
 #include <X11/Xlib.h>
 #include <X11/Xlibint.h>
 #include <X11/extensions/XInput2.h>
+#include <X11/extensions/XRes.h>
 
 struct xorg::testing::XServer::Private {
   Private()
       : display_number(DEFAULT_DISPLAY),
-        path_to_server(DEFAULT_XORG_SERVER) {
+        path_to_server(DEFAULT_XORG_SERVER),
+        prebind(false),
+        isolation(ISOLATION_NONE) {
   }
 
   unsigned int display_number;
@@ -59,6 +72,8 @@ struct xorg::testing::XServer::Private {
   std::string path_to_server;
   std::map<std::string, std::string> options;
   std::string version;
+  bool prebind;
+  enum Isolation isolation;
 };
 
 xorg::testing::XServer::XServer() : d_(new Private) {
@@ -88,6 +103,70 @@ const std::string& xorg::testing::XServer::GetDisplayString(void) {
   return d_->display_string;
 }
 
+void xorg::testing::XServer::SetPrebindSocket(bool prebind) {
+  d_->prebind = prebind;
+}
+
+void xorg::testing::XServer::SetIsolation(enum Isolation isolation) {
+  d_->isolation = isolation;
+}
+
+static void write_proc_file(const std::string &path, const std::string &contents) {
+  int fd = open(path.c_str(), O_WRONLY);
+  if (fd == -1) {
+    /* setgroups only exists since Linux 3.19, no need to deny it before */
+    if (errno == ENOENT && path == "/proc/self/setgroups")
+      return;
+    throw std::runtime_error("Failed to open " + path + ": " + std::strerror(errno));
+  }
+
+  ssize_t len = write(fd, contents.c_str(), contents.size());
+  close(fd);
+  if (len != static_cast<ssize_t>(contents.size()))
+    throw std::runtime_error("Failed to write " + path);
+}
+
+void xorg::testing::XServer::Isolate(enum Isolation isolation) {
+  static bool isolated = false;
+
+  if (isolation == ISOLATION_NONE || isolated)
+    return;
+
+  uid_t uid = getuid();
+  gid_t gid = getgid();
+
+  int flags = CLONE_NEWUSER | CLONE_NEWNS;
+  if (isolation == ISOLATION_NETWORK)
+    flags |= CLONE_NEWNET;
+
+  if (unshare(flags) == -1) {
+    std::string err_msg("Failed to create namespaces: ");
+    err_msg.append(std::strerror(errno));
+    if (errno == EINVAL)
+      err_msg.append(" (was a thread started before?)");
+    throw std::runtime_error(err_msg);
+  }
+
+  /* Map ourselves to root, the server expects to be root */
+  std::stringstream uid_map, gid_map;
+  uid_map << "0 " << uid << " 1";
+  gid_map << "0 " << gid << " 1";
+
+  write_proc_file("/proc/self/setgroups", "deny");
+  write_proc_file("/proc/self/uid_map", uid_map.str());
+  write_proc_file("/proc/self/gid_map", gid_map.str());
+
+  /* Don't propagate our mounts back to the host */
+  if (mount(NULL, "/", NULL, MS_REC | MS_PRIVATE, NULL) == -1 ||
+      mount("tmpfs", "/tmp", "tmpfs", MS_NOSUID | MS_NODEV, "mode=1777") == -1) {
+    std::string err_msg("Failed to mount private /tmp: ");
+    err_msg.append(std::strerror(errno));
+    throw std::runtime_error(err_msg);
+  }
+
+  isolated = true;
+}
+
 void xorg::testing::XServer::SetServerPath(const std::string &path_to_server) {
   d_->path_to_server = path_to_server;
 }
@@ -253,8 +332,8 @@ bool xorg::testing::XServer::WaitForDevice(::Display *display, const std::string
     int error_start;
     bool device_found = false;
 
-    if (!XQueryExtension(display, "XInputExtension", &opcode, &event_start,
-                         &error_start))
+    if (!DisplayCache::QueryExtension(display, "XInputExtension", &opcode,
+                                      &event_start, &error_start))
         throw std::runtime_error("Failed to query XInput extension");
 
     XIEventMask *masks;
@@ -320,6 +399,73 @@ bool xorg::testing::XServer::WaitForDevice(::Display *display, const std::string
     return device_found;
 }
 
+static bool device_exists(::Display *display, const std::string &name)
+{
+    int ndevices;
+    XIDeviceInfo *info = XIQueryDevice(display, XIAllDevices, &ndevices);
+
+    bool found = false;
+    for (int i = 0; !found && i < ndevices; i++)
+        found = (name.compare(info[i].name) == 0);
+    XIFreeDeviceInfo(info);
+
+    return found;
+}
+
+bool xorg::testing::XServer::WaitForDevices(::Display *display,
+                                            const std::vector<std::string> &names,
+                                            time_t timeout)
+{
+    struct timespec start, now;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    for (size_t i = 0; i < names.size(); i++) {
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        time_t elapsed = (now.tv_sec - start.tv_sec) * 1000 +
+                         (now.tv_nsec - start.tv_nsec) / 1000000;
+
+        /* a timeout of 0 would wait forever, out of time only check
+           for devices already added */
+        if (elapsed >= timeout) {
+            if (!device_exists(display, names[i]))
+                return false;
+        } else if (!WaitForDevice(display, names[i], timeout - elapsed)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+unsigned int xorg::testing::XServer::KillOtherClients(::Display *display)
+{
+    int event_base, error_base;
+    if (!XResQueryExtension(display, &event_base, &error_base))
+        throw std::runtime_error("X-Resource extension not available");
+
+    int nclients;
+    XResClient *clients;
+    if (!XResQueryClients(display, &nclients, &clients))
+        throw std::runtime_error("Failed to query clients");
+
+    unsigned int killed = 0;
+    for (int i = 0; i < nclients; i++) {
+        /* resource base 0 is the server itself, and would be AllTemporary
+           for XKillClient */
+        if (clients[i].resource_base == 0 ||
+            clients[i].resource_base == display->resource_base)
+            continue;
+
+        XKillClient(display, clients[i].resource_base);
+        killed++;
+    }
+
+    XFree(clients);
+    XSync(display, False);
+
+    return killed;
+}
+
 void xorg::testing::XServer::WaitForConnections(void) {
 }
 
@@ -460,15 +606,105 @@ void xorg::testing::XServer::RegisterXErrorHandler()
     XSetErrorHandler(old_handler);
 }
 
+/* Wait for SIGUSR1 or SIGCHLD from the server with the given pid, both must be
+ * blocked. The server sends SIGUSR1 whenever it is ready after startup or
+ * regeneration, Start() uses this while the server is its only child being
+ * started. Signals from other processes, e.g. other servers, are
+ * discarded. Returns the signal received or 0 on timeout. */
+static int wait_for_server_signal(pid_t pid, unsigned int timeout) {
+  sigset_t sig_mask;
+  sigemptyset(&sig_mask);
+  sigaddset(&sig_mask, SIGUSR1);
+  sigaddset(&sig_mask, SIGCHLD);
+
+  struct timespec deadline;
+  clock_gettime(CLOCK_MONOTONIC, &deadline);
+  deadline.tv_sec += timeout / 1000;
+  deadline.tv_nsec += (timeout % 1000) * 1000000L;
+  if (deadline.tv_nsec >= 1000000000L) {
+    deadline.tv_sec++;
+    deadline.tv_nsec -= 1000000000L;
+  }
+
+  while (true) {
+    struct timespec now, remaining;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    remaining.tv_sec = deadline.tv_sec - now.tv_sec;
+    remaining.tv_nsec = deadline.tv_nsec - now.tv_nsec;
+    if (remaining.tv_nsec < 0) {
+      remaining.tv_sec--;
+      remaining.tv_nsec += 1000000000L;
+    }
+    if (remaining.tv_sec < 0)
+      return 0;
+
+    siginfo_t info;
+    int recv_sig = sigtimedwait(&sig_mask, &info, &remaining);
+    if (recv_sig == -1) {
+      if (errno == EINTR)
+        continue;
+      if (errno == EAGAIN)
+        return 0;
+
+      std::string err_msg("Error while waiting for XServer: ");
+      err_msg.append(std::strerror(errno));
+      throw std::runtime_error(err_msg);
+    }
+
+    if (info.si_pid == pid)
+      return recv_sig;
+  }
+}
+
+/* Create the socket the server would otherwise create itself. Clients
+ * try the abstract socket first and fall back to this one while the server
+ * hasn't set up its own sockets yet. */
+static int create_listen_socket(unsigned int display_number) {
+  std::stringstream path;
+  path << X11_SOCKET_DIR << "/X" << display_number;
+
+  struct sockaddr_un addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  if (path.str().size() >= sizeof(addr.sun_path))
+    throw std::runtime_error("Socket path " + path.str() + " is too long");
+  strcpy(addr.sun_path, path.str().c_str());
+
+  if (mkdir(X11_SOCKET_DIR, 01777) == 0)
+    chmod(X11_SOCKET_DIR, 01777); /* mkdir applies the umask */
+
+  int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (fd == -1)
+    throw std::runtime_error("Failed to create listening socket");
+
+  /* TestStartup() made sure no server is running, this is a leftover */
+  unlink(addr.sun_path);
+
+  if (bind(fd, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) == -1 ||
+      listen(fd, SOMAXCONN) == -1) {
+    std::string err_msg("Failed to bind listening socket " + path.str() + ": ");
+    err_msg.append(std::strerror(errno));
+    close(fd);
+    throw std::runtime_error(err_msg);
+  }
+
+  return fd;
+}
+
 void xorg::testing::XServer::Start(const std::string &program) {
+  Isolate(d_->isolation);
+
   TestStartup();
 
+  int listen_fd = -1;
+  if (d_->prebind)
+    listen_fd = create_listen_socket(d_->display_number);
+
   std::vector<std::string> args;
   std::map<std::string, std::string>::iterator it;
   std::string err_msg;
 
   sigset_t sig_mask;
-  struct timespec sig_timeout = {3, 0}; /* 3 sec + 0 nsec */
 
   /* add SIGUSR1 to the signal mask */
   sigemptyset(&sig_mask);
@@ -480,7 +716,15 @@ void xorg::testing::XServer::Start(const std::string &program) {
     throw std::runtime_error(err_msg);
   }
 
-  pid_t pid = Fork();
+  pid_t pid;
+  try {
+    pid = Fork();
+  } catch (const std::runtime_error&) {
+    if (listen_fd != -1)
+      close(listen_fd);
+    throw;
+  }
+
   if (pid == 0) {
 #ifdef __linux
     if (getenv("XORG_GTEST_XSERVER_KEEPALIVE"))
@@ -509,6 +753,13 @@ void xorg::testing::XServer::Start(const std::string &program) {
 
     args.push_back(std::string(GetDisplayString()));
 
+    if (listen_fd != -1) {
+      std::stringstream fd;
+      fd << listen_fd;
+      args.push_back("-listenfd");
+      args.push_back(fd.str());
+    }
+
     for (it = d_->options.begin(); it != d_->options.end(); it++) {
       args.push_back(it->first);
       if (!it->second.empty())
@@ -525,29 +776,115 @@ void xorg::testing::XServer::Start(const std::string &program) {
   if (sleepwait)
     raise(SIGSTOP);
 
-  /* wait for SIGUSR1 from XServer */
-  int recv_sig = sigtimedwait(&sig_mask, NULL, &sig_timeout);
-  if (recv_sig == SIGCHLD) {
-    GetState();
-  } else if (recv_sig != SIGUSR1 && errno != EAGAIN) {
-    err_msg.append("Error while waiting for XServer startup: ");
-    err_msg.append(std::strerror(errno));
-    throw std::runtime_error(err_msg);
+  if (listen_fd != -1) {
+    /* Don't wait, connections queue up on the socket until the server is
+     * ready. Only the server may hold the socket open, otherwise clients
+     * hang instead of failing if the server dies during startup. */
+    close(listen_fd);
+  } else {
+    /* wait for SIGUSR1 from XServer */
+    if (wait_for_server_signal(pid, 3000) == SIGCHLD)
+      GetState();
   }
 
+  /* Ignore SIGUSR1, it's triggered on server regeneration. Tests that need
+   * to handle SIGUSR1 will have to install their own signal handler anyways.
+   * This must happen before unblocking, with a pre-bound socket the
+   * server's first SIGUSR1 may still be on its way. */
+  signal(SIGUSR1 ,SIG_IGN);
+
   sigemptyset(&sig_mask);
   sigaddset(&sig_mask, SIGCHLD);
   sigaddset(&sig_mask, SIGUSR1);
   sigprocmask(SIG_UNBLOCK, &sig_mask, NULL);
 
-  /* Ignore SIGUSR1, it's triggered on server regeneration. Tests that need
-   * to handle SIGUSR1 will have to install their own signal handler anyways */
-  signal(SIGUSR1 ,SIG_IGN);
-
   RegisterXIOErrorHandler();
   RegisterXErrorHandler();
 }
 
+/* Senders of SIGUSR1 after Start(), written by the handler below. Other
+ * threads may not block SIGUSR1, so the signal may be handled by any
+ * thread; the pipe hands it to the thread waiting for it. */
+static int ready_pipe[2] = { -1, -1 };
+static pthread_mutex_t ready_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static void ready_signal_handler(int sig, siginfo_t *info, void *context) {
+  int saved_errno = errno;
+  pid_t pid = info->si_pid;
+  /* a full pipe only loses signals nobody waits for */
+  if (write(ready_pipe[1], &pid, sizeof(pid)) != sizeof(pid)) {}
+  errno = saved_errno;
+}
+
+static bool install_ready_signal_handler() {
+  if (ready_pipe[0] == -1) {
+    if (pipe(ready_pipe) != 0)
+      return false;
+    for (int i = 0; i < 2; i++) {
+      fcntl(ready_pipe[i], F_SETFL, O_NONBLOCK);
+      fcntl(ready_pipe[i], F_SETFD, FD_CLOEXEC);
+    }
+  }
+
+  struct sigaction action;
+  memset(&action, 0, sizeof(action));
+  action.sa_sigaction = ready_signal_handler;
+  action.sa_flags = SA_SIGINFO | SA_RESTART;
+  sigemptyset(&action.sa_mask);
+  return sigaction(SIGUSR1, &action, NULL) == 0;
+}
+
+bool xorg::testing::XServer::Regenerate(unsigned int timeout) {
+  if (GetState() != Process::RUNNING || Pid() <= 0)
+    return false;
+
+  /* one waiter at a time, a pid read from the pipe is gone for others */
+  pthread_mutex_lock(&ready_mutex);
+
+  if (!install_ready_signal_handler()) {
+    pthread_mutex_unlock(&ready_mutex);
+    return false;
+  }
+
+  /* signals from before the SIGHUP, e.g. of another server's startup */
+  pid_t pid;
+  while (read(ready_pipe[0], &pid, sizeof(pid)) > 0)
+    ;
+
+  bool ready = false;
+  if (kill(Pid(), SIGHUP) == 0) {
+    struct timespec start, now;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    struct pollfd pfd;
+    pfd.fd = ready_pipe[0];
+    pfd.events = POLLIN;
+
+    while (!ready) {
+      clock_gettime(CLOCK_MONOTONIC, &now);
+      long elapsed = (now.tv_sec - start.tv_sec) * 1000 +
+                     (now.tv_nsec - start.tv_nsec) / 1000000;
+      if (elapsed >= static_cast<long>(timeout))
+        break;
+
+      /* wake up now and then to notice a server that died */
+      long wait = timeout - elapsed;
+      poll(&pfd, 1, wait < 10 ? wait : 10);
+
+      while (read(ready_pipe[0], &pid, sizeof(pid)) == sizeof(pid))
+        if (pid == Pid())
+          ready = true;
+
+      if (!ready && GetState() != Process::RUNNING)
+        break;
+    }
+  }
+
+  pthread_mutex_unlock(&ready_mutex);
+
+  return ready;
+}
+
 bool xorg::testing::XServer::Terminate(unsigned int timeout) {
   if (getenv("XORG_GTEST_XSERVER_KEEPALIVE"))
     return true;
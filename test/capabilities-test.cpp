@@ -0,0 +1,91 @@
+#include <gtest/gtest.h>
+#include <xorg/gtest/xorg-gtest.h>
+
+#ifdef HAVE_EVEMU
+#include "PIXART-USB-OPTICAL-MOUSE.h"
+#include "SynPS2-Synaptics-TouchPad.h"
+
+using namespace xorg::testing::evemu;
+
+TEST(DeviceCapabilities, Snapshot)
+{
+  XORG_TESTCASE("A snapshot has the same events and axes as its device,\n"
+                "the descriptor gives the same snapshot");
+
+  Device d(TEST_ROOT_DIR "SynPS2-Synaptics-TouchPad.desc");
+  DeviceCapabilities caps(d);
+
+  for (int type = EV_KEY; type <= EV_ABS; type++)
+    for (int code = 0; code < KEY_MAX; code++)
+      ASSERT_EQ(caps.HasEvent(type, code), d.HasEvent(type, code))
+        << "Type " << type << " code " << code;
+
+  int min, max, fuzz;
+  ASSERT_TRUE(caps.GetAbsData(ABS_X, &min, &max, &fuzz));
+  ASSERT_EQ(min, 1472);
+  ASSERT_EQ(max, 5472);
+  ASSERT_EQ(fuzz, 8);
+  ASSERT_FALSE(caps.GetAbsData(ABS_RX, &min, &max));
+
+  ASSERT_EQ(caps.Count(EV_ABS), 9U);
+  ASSERT_EQ(caps, DeviceCapabilities(descriptors::SynPS2_Synaptics_TouchPad::descriptor));
+}
+
+TEST(DeviceCapabilities, Iteration)
+{
+  XORG_TESTCASE("NextCode() visits all supported codes in order");
+
+  DeviceCapabilities caps(descriptors::PIXART_USB_OPTICAL_MOUSE::descriptor);
+
+  std::vector<int> codes;
+  for (int code = caps.NextCode(EV_REL, -1); code != -1;
+       code = caps.NextCode(EV_REL, code))
+    codes.push_back(code);
+
+  ASSERT_EQ(codes.size(), 3U);
+  ASSERT_EQ(codes[0], REL_X);
+  ASSERT_EQ(codes[1], REL_Y);
+  ASSERT_EQ(codes[2], REL_WHEEL);
+  ASSERT_EQ(caps.NextCode(EV_ABS, -1), -1);
+}
+
+TEST(DeviceCapabilities, SetOperations)
+{
+  XORG_TESTCASE("Intersection, union and difference of two devices");
+
+  DeviceCapabilities mouse(descriptors::PIXART_USB_OPTICAL_MOUSE::descriptor);
+  DeviceCapabilities touchpad(descriptors::SynPS2_Synaptics_TouchPad::descriptor);
+
+  DeviceCapabilities common = mouse & touchpad;
+  ASSERT_EQ(common.Count(EV_KEY), 1U);
+  ASSERT_TRUE(common.HasEvent(EV_KEY, BTN_LEFT));
+  ASSERT_EQ(common.Count(EV_ABS), 0U);
+  ASSERT_EQ(common.Count(EV_REL), 0U);
+
+  DeviceCapabilities all = mouse | touchpad;
+  ASSERT_TRUE(all.HasEvent(EV_REL, REL_WHEEL));
+  ASSERT_TRUE(all.HasEvent(EV_ABS, ABS_MT_SLOT));
+  int min, max;
+  ASSERT_TRUE(all.GetAbsData(ABS_MT_SLOT, &min, &max));
+  ASSERT_EQ(max, 1);
+
+  DeviceCapabilities only_mouse = mouse - touchpad;
+  ASSERT_FALSE(only_mouse.HasEvent(EV_KEY, BTN_LEFT));
+  ASSERT_TRUE(only_mouse.HasEvent(EV_KEY, BTN_RIGHT));
+  ASSERT_TRUE(only_mouse.HasEvent(EV_SYN, EV_REL));
+  ASSERT_FALSE(only_mouse.HasEvent(EV_SYN, EV_ABS));
+
+  ASSERT_EQ(all - touchpad - mouse, DeviceCapabilities());
+  ASSERT_NE(mouse, touchpad);
+
+  DeviceCapabilities moved(touchpad);
+  moved.SetAbsData(ABS_X, 0, 100);
+  ASSERT_NE(moved, touchpad) << "Axis ranges are compared";
+}
+
+#endif
+
+int main(int argc, char *argv[]) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,87 @@
+#include <time.h>
+
+#include <iostream>
+#include <sstream>
+
+#include <gtest/gtest.h>
+#include <xorg/gtest/xorg-gtest.h>
+
+#ifdef HAVE_EVEMU
+
+/**
+ * Event injection benchmarks. These are not run as part of make check,
+ * run ./device-benchmark manually. Each benchmark prints the number of
+ * events per second and records it as a test property for --gtest_output.
+ */
+
+static const int frames = 20000;
+
+static double now_ms(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0;
+}
+
+static void report(const std::string &name, int events, double elapsed_ms)
+{
+  double rate = events / (elapsed_ms / 1000.0);
+
+  std::cout << "[ BENCHMARK] " << name << ": " << rate << " events/s ("
+            << events << " events in " << elapsed_ms << " ms)\n";
+
+  std::stringstream s;
+  s << rate;
+  ::testing::Test::RecordProperty(name.c_str(), s.str().c_str());
+}
+
+TEST(DeviceBenchmark, PlayOne)
+{
+  xorg::testing::evemu::Device d(TEST_ROOT_DIR "PIXART-USB-OPTICAL-MOUSE.desc");
+
+  double start = now_ms();
+  for (int i = 0; i < frames; i++) {
+    d.PlayOne(EV_REL, REL_X, 1);
+    d.PlayOne(EV_REL, REL_Y, -1, true);
+  }
+  report("play-one", frames * 3, now_ms() - start);
+}
+
+TEST(DeviceBenchmark, FramePerWrite)
+{
+  xorg::testing::evemu::Device d(TEST_ROOT_DIR "PIXART-USB-OPTICAL-MOUSE.desc");
+
+  double start = now_ms();
+  for (int i = 0; i < frames; i++) {
+    d.QueueEvent(EV_REL, REL_X, 1);
+    d.QueueEvent(EV_REL, REL_Y, -1);
+    d.EndFrame();
+    d.Flush();
+  }
+  report("frame-per-write", frames * 3, now_ms() - start);
+}
+
+TEST(DeviceBenchmark, FramesPerWrite)
+{
+  static const int batch = 100;
+
+  xorg::testing::evemu::Device d(TEST_ROOT_DIR "PIXART-USB-OPTICAL-MOUSE.desc");
+
+  double start = now_ms();
+  for (int i = 0; i < frames; i++) {
+    d.QueueEvent(EV_REL, REL_X, 1);
+    d.QueueEvent(EV_REL, REL_Y, -1);
+    d.EndFrame();
+    if ((i + 1) % batch == 0)
+      d.Flush();
+  }
+  d.Flush();
+  report("100-frames-per-write", frames * 3, now_ms() - start);
+}
+
+#endif
+
+int main(int argc, char *argv[]) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -2,6 +2,21 @@
 #include <xorg/gtest/xorg-gtest.h>
 
 #ifdef HAVE_EVEMU
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sys/ioctl.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include <set>
+#include <vector>
+
+#include "PIXART-USB-OPTICAL-MOUSE.h"
+#include "SynPS2-Synaptics-TouchPad.h"
+
 #ifndef BTN_TOOL_QUINTTAP
 #define BTN_TOOL_QUINTTAP 0x148
 #endif
@@ -27,6 +42,332 @@ TEST(Device, InotifyWait)
   ASSERT_FALSE(d.GetDeviceNode().empty());
 }
 
+static void* create_device(void *data) {
+  xorg::testing::evemu::Device **device =
+    static_cast<xorg::testing::evemu::Device**>(data);
+  *device = new xorg::testing::evemu::Device(TEST_ROOT_DIR "PIXART-USB-OPTICAL-MOUSE.desc");
+  return NULL;
+}
+
+TEST(Device, ParallelCreation)
+{
+  XORG_TESTCASE("Devices created at the same time get their own device\n"
+                "node");
+
+  const int NUM_DEVICES = 4;
+  xorg::testing::evemu::Device *devices[NUM_DEVICES];
+  pthread_t threads[NUM_DEVICES];
+
+  for (int i = 0; i < NUM_DEVICES; i++)
+    ASSERT_EQ(pthread_create(&threads[i], NULL, create_device, &devices[i]), 0);
+  for (int i = 0; i < NUM_DEVICES; i++)
+    pthread_join(threads[i], NULL);
+
+  std::set<std::string> nodes;
+  for (int i = 0; i < NUM_DEVICES; i++) {
+    ASSERT_FALSE(devices[i]->GetDeviceNode().empty());
+    nodes.insert(devices[i]->GetDeviceNode());
+  }
+  ASSERT_EQ(nodes.size(), (size_t)NUM_DEVICES);
+
+  for (int i = 0; i < NUM_DEVICES; i++)
+    delete devices[i];
+}
+
+TEST(Device, CreateMany)
+{
+  XORG_TESTCASE("Devices created together all have their device node\n"
+                "when CreateMany() returns");
+
+  std::vector<xorg::testing::evemu::DeviceDescription> descriptions;
+  for (int i = 0; i < 2; i++) {
+    descriptions.push_back(xorg::testing::evemu::DeviceDescription::FromFile(TEST_ROOT_DIR "PIXART-USB-OPTICAL-MOUSE.desc"));
+    descriptions.push_back(xorg::testing::evemu::DeviceDescription::FromFile(TEST_ROOT_DIR "SynPS2-Synaptics-TouchPad.desc"));
+  }
+
+  std::vector<xorg::testing::evemu::Device*> devices =
+    xorg::testing::evemu::Device::CreateMany(descriptions);
+  ASSERT_EQ(devices.size(), descriptions.size());
+
+  std::set<std::string> nodes;
+  for (size_t i = 0; i < devices.size(); i++) {
+    const std::string &node = devices[i]->GetDeviceNode();
+    ASSERT_FALSE(node.empty());
+    ASSERT_EQ(access(node.c_str(), F_OK), 0);
+    nodes.insert(node);
+  }
+  ASSERT_EQ(nodes.size(), devices.size());
+
+  ASSERT_FALSE(devices[0]->HasEvent(EV_ABS, ABS_X));
+  ASSERT_TRUE(devices[1]->HasEvent(EV_ABS, ABS_X));
+
+  for (size_t i = 0; i < devices.size(); i++)
+    delete devices[i];
+
+  descriptions.push_back(xorg::testing::evemu::DeviceDescription(""));
+  ASSERT_THROW(xorg::testing::evemu::Device::CreateMany(descriptions),
+               std::runtime_error);
+}
+
+TEST(Device, QueuedEvents)
+{
+  XORG_TESTCASE("Queued frames are written in one go and show up on the\n"
+                "device node");
+
+  xorg::testing::evemu::Device d(TEST_ROOT_DIR "PIXART-USB-OPTICAL-MOUSE.desc");
+
+  int fd = open(d.GetDeviceNode().c_str(), O_RDONLY | O_NONBLOCK);
+  ASSERT_GE(fd, 0);
+
+  d.Flush(); /* empty queue is a noop */
+
+  for (int i = 1; i <= 2; i++) {
+    d.QueueEvent(EV_REL, REL_X, i);
+    d.EndFrame();
+  }
+  d.Flush();
+
+  struct input_event events[4];
+  struct pollfd pfd = { fd, POLLIN, 0 };
+  ASSERT_GT(poll(&pfd, 1, 1000), 0);
+  ASSERT_EQ(read(fd, events, sizeof(events)), (ssize_t)sizeof(events));
+  ASSERT_EQ(events[0].code, REL_X);
+  ASSERT_EQ(events[0].value, 1);
+  ASSERT_EQ(events[1].type, EV_SYN);
+  ASSERT_EQ(events[2].value, 2);
+  ASSERT_EQ(events[3].type, EV_SYN);
+
+  close(fd);
+}
+
+TEST(Device, CompiledRecording)
+{
+  XORG_TESTCASE("A recording is compiled once and plays back all of its\n"
+                "frames");
+
+  char recording[] = "/tmp/xorg-gtest-recording-XXXXXX";
+  int rfd = mkstemp(recording);
+  ASSERT_GE(rfd, 0);
+  const char events[] = "E: 0.000000 0002 0000 1\n"
+                        "E: 0.000000 0000 0000 0\n"
+                        "E: 0.010000 0002 0000 2\n"
+                        "E: 0.010000 0002 0001 3\n"
+                        "E: 0.010000 0000 0000 0\n";
+  ASSERT_EQ(write(rfd, events, sizeof(events) - 1), (ssize_t)sizeof(events) - 1);
+  close(rfd);
+
+  std::string compiled = xorg::testing::evemu::Device::CompileRecording(recording);
+  struct stat st;
+  ASSERT_EQ(stat(compiled.c_str(), &st), 0);
+  ASSERT_EQ(xorg::testing::evemu::Device::CompileRecording(recording), compiled);
+
+  struct stat st2;
+  ASSERT_EQ(stat(compiled.c_str(), &st2), 0);
+  ASSERT_EQ(st.st_ino, st2.st_ino) << "Recording was compiled twice";
+
+  xorg::testing::evemu::Device d(TEST_ROOT_DIR "PIXART-USB-OPTICAL-MOUSE.desc");
+  int fd = open(d.GetDeviceNode().c_str(), O_RDONLY | O_NONBLOCK);
+  ASSERT_GE(fd, 0);
+
+  d.PlayCompiled(recording);
+
+  struct input_event ev[5];
+  struct pollfd pfd = { fd, POLLIN, 0 };
+  ASSERT_GT(poll(&pfd, 1, 1000), 0);
+  ASSERT_EQ(read(fd, ev, sizeof(ev)), (ssize_t)sizeof(ev));
+  ASSERT_EQ(ev[0].value, 1);
+  ASSERT_EQ(ev[2].value, 2);
+  ASSERT_EQ(ev[3].code, REL_Y);
+  ASSERT_EQ(ev[3].value, 3);
+
+  close(fd);
+  unlink(compiled.c_str());
+  unlink(recording);
+}
+
+TEST(Device, CompiledRecordingUntrusted)
+{
+  XORG_TESTCASE("Compiled recordings writable by others or with a broken\n"
+                "frame index are compiled again");
+
+  char recording[] = "/tmp/xorg-gtest-recording-XXXXXX";
+  int rfd = mkstemp(recording);
+  ASSERT_GE(rfd, 0);
+  const char events[] = "E: 0.000000 0002 0000 1\n"
+                        "E: 0.000000 0000 0000 0\n";
+  ASSERT_EQ(write(rfd, events, sizeof(events) - 1), (ssize_t)sizeof(events) - 1);
+  close(rfd);
+
+  std::string compiled = xorg::testing::evemu::Device::CompileRecording(recording);
+  struct stat st;
+  ASSERT_EQ(stat(compiled.c_str(), &st), 0);
+  ASSERT_EQ(st.st_mode & 022, 0U);
+
+  ASSERT_EQ(chmod(compiled.c_str(), 0666), 0);
+  ASSERT_EQ(xorg::testing::evemu::Device::CompileRecording(recording), compiled);
+  struct stat st2;
+  ASSERT_EQ(stat(compiled.c_str(), &st2), 0);
+  ASSERT_NE(st.st_ino, st2.st_ino) << "Writable recording was reused";
+  ASSERT_EQ(st2.st_mode & 022, 0U);
+
+  /* the first frame offset follows the header */
+  int cfd = open(compiled.c_str(), O_WRONLY);
+  ASSERT_GE(cfd, 0);
+  unsigned int offset = 0xffffffff;
+  ASSERT_EQ(pwrite(cfd, &offset, sizeof(offset), 32), (ssize_t)sizeof(offset));
+  close(cfd);
+
+  ASSERT_EQ(xorg::testing::evemu::Device::CompileRecording(recording), compiled);
+  ASSERT_EQ(stat(compiled.c_str(), &st), 0);
+  ASSERT_NE(st.st_ino, st2.st_ino) << "Broken recording was reused";
+
+  unlink(compiled.c_str());
+  unlink(recording);
+}
+
+TEST(Device, PlaybackModes)
+{
+  XORG_TESTCASE("Scaled and fast playback shorten the recorded delays,\n"
+                "real-time playback keeps them");
+
+  char recording[] = "/tmp/xorg-gtest-recording-XXXXXX";
+  int rfd = mkstemp(recording);
+  ASSERT_GE(rfd, 0);
+  const char events[] = "E: 0.000000 0002 0000 1\n"
+                        "E: 0.000000 0000 0000 0\n"
+                        "E: 0.100000 0002 0000 1\n"
+                        "E: 0.100000 0000 0000 0\n";
+  ASSERT_EQ(write(rfd, events, sizeof(events) - 1), (ssize_t)sizeof(events) - 1);
+  close(rfd);
+
+  xorg::testing::evemu::Device d(TEST_ROOT_DIR "PIXART-USB-OPTICAL-MOUSE.desc");
+
+  d.Play(recording, xorg::testing::evemu::Device::PLAYBACK_REALTIME);
+  xorg::testing::evemu::Device::PlaybackStats stats = d.GetPlaybackStats();
+  ASSERT_EQ(stats.frames, 2U);
+  ASSERT_DOUBLE_EQ(stats.target_ms, 100);
+  ASSERT_GE(stats.actual_ms, 100);
+  ASSERT_GE(stats.max_jitter_us, stats.mean_jitter_us);
+
+  d.Play(recording, xorg::testing::evemu::Device::PLAYBACK_SCALED, 10);
+  stats = d.GetPlaybackStats();
+  ASSERT_DOUBLE_EQ(stats.target_ms, 10);
+  ASSERT_GE(stats.actual_ms, 10);
+  ASSERT_LT(stats.actual_ms, 100);
+
+  d.Play(recording, xorg::testing::evemu::Device::PLAYBACK_FAST);
+  stats = d.GetPlaybackStats();
+  ASSERT_EQ(stats.frames, 2U);
+  ASSERT_EQ(stats.target_ms, 0);
+  ASSERT_LT(stats.actual_ms, 100);
+
+  ASSERT_THROW(d.Play(recording, xorg::testing::evemu::Device::PLAYBACK_SCALED, 0),
+               std::runtime_error);
+
+  unlink(xorg::testing::evemu::Device::CompileRecording(recording).c_str());
+  unlink(recording);
+}
+
+TEST(Device, Description)
+{
+  XORG_TESTCASE("Devices can be created from in-memory descriptions,\n"
+                "descriptions read from a file are reread when it changes");
+
+  char path[] = "/tmp/xorg-gtest-desc-XXXXXX";
+  int fd = mkstemp(path);
+  ASSERT_GE(fd, 0);
+  close(fd);
+
+  xorg::testing::evemu::DeviceDescription mouse =
+    xorg::testing::evemu::DeviceDescription::FromFile(TEST_ROOT_DIR "PIXART-USB-OPTICAL-MOUSE.desc");
+  ASSERT_FALSE(mouse.GetText().empty());
+
+  /* the cache is keyed by size and mtime, keep both fixed while the
+     contents change to see which text is served */
+  struct timeval times[2] = { { 1, 0 }, { 1, 0 } };
+  std::string changed = mouse.GetText();
+  changed[3] = (changed[3] == 'X') ? 'Y' : 'X';
+
+  FILE *fp = fopen(path, "w");
+  ASSERT_TRUE(fp != NULL);
+  fputs(mouse.GetText().c_str(), fp);
+  fclose(fp);
+  ASSERT_EQ(utimes(path, times), 0);
+
+  xorg::testing::evemu::DeviceDescription copy =
+    xorg::testing::evemu::DeviceDescription::FromFile(path);
+  ASSERT_EQ(copy.GetText(), mouse.GetText());
+
+  fp = fopen(path, "w");
+  ASSERT_TRUE(fp != NULL);
+  fputs(changed.c_str(), fp);
+  fclose(fp);
+  ASSERT_EQ(utimes(path, times), 0);
+
+  copy = xorg::testing::evemu::DeviceDescription::FromFile(path);
+  ASSERT_EQ(copy.GetText(), mouse.GetText()) << "Unchanged file was reread";
+
+  /* same size, new modification time */
+  times[0].tv_sec = times[1].tv_sec = 2;
+  ASSERT_EQ(utimes(path, times), 0);
+
+  copy = xorg::testing::evemu::DeviceDescription::FromFile(path);
+  ASSERT_EQ(copy.GetText(), changed) << "Modified file was not reread";
+
+  copy =
+    xorg::testing::evemu::DeviceDescription::FromFile(TEST_ROOT_DIR "SynPS2-Synaptics-TouchPad.desc");
+
+  xorg::testing::evemu::Device d(copy);
+  ASSERT_TRUE(d.HasEvent(EV_ABS, ABS_MT_SLOT));
+
+  ASSERT_THROW(xorg::testing::evemu::Device(xorg::testing::evemu::DeviceDescription("")),
+               std::runtime_error);
+
+  unlink(path);
+}
+
+XORG_GTEST_STATIC_ASSERT((xorg::testing::evemu::descriptors::SynPS2_Synaptics_TouchPad::Has<EV_ABS, ABS_MT_SLOT>::value),
+                         touchpad_is_multitouch);
+XORG_GTEST_STATIC_ASSERT((!xorg::testing::evemu::descriptors::PIXART_USB_OPTICAL_MOUSE::Has<EV_ABS, ABS_X>::value),
+                         mouse_is_relative);
+
+TEST(Device, Descriptor)
+{
+  XORG_TESTCASE("Devices created from generated descriptors match the\n"
+                "devices created from the .desc file");
+
+  using namespace xorg::testing::evemu::descriptors;
+
+  xorg::testing::evemu::Device d(SynPS2_Synaptics_TouchPad::descriptor);
+  xorg::testing::evemu::Device ref(TEST_ROOT_DIR "SynPS2-Synaptics-TouchPad.desc");
+
+  ASSERT_FALSE(d.GetDeviceNode().empty());
+
+  char name[256] = {0};
+  int fd = open(d.GetDeviceNode().c_str(), O_RDONLY);
+  ASSERT_GE(fd, 0);
+  ASSERT_GE(ioctl(fd, EVIOCGNAME(sizeof(name)), name), 0);
+  ASSERT_STREQ(name, "SynPS/2 Synaptics TouchPad");
+  close(fd);
+
+  for (int type = EV_KEY; type <= EV_ABS; type++)
+    for (int code = 0; code < KEY_MAX; code++)
+      ASSERT_EQ(d.HasEvent(type, code), ref.HasEvent(type, code))
+        << "Type " << type << " code " << code;
+
+  for (int code = ABS_X; code < ABS_MAX; code++) {
+    int min = 0, max = 0, fuzz = 0, ref_min = 0, ref_max = 0, ref_fuzz = 0;
+    ASSERT_EQ(d.GetAbsData(code, &min, &max, &fuzz),
+              ref.GetAbsData(code, &ref_min, &ref_max, &ref_fuzz));
+    ASSERT_EQ(min, ref_min);
+    ASSERT_EQ(max, ref_max);
+    ASSERT_EQ(fuzz, ref_fuzz);
+  }
+
+  xorg::testing::evemu::Device mouse(PIXART_USB_OPTICAL_MOUSE::descriptor);
+  ASSERT_TRUE(mouse.HasEvent(EV_REL, REL_WHEEL));
+}
+
 TEST(Device, HasEvent)
 {
     XORG_TESTCASE("HasEvent must return the right bits.\n");
@@ -0,0 +1,153 @@
+#include <gtest/gtest.h>
+#include <xorg/gtest/xorg-gtest.h>
+
+#ifdef HAVE_EVEMU
+#include <fcntl.h>
+#include <poll.h>
+#include <stdint.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+
+#include <X11/extensions/XInput2.h>
+
+using namespace xorg::testing;
+using namespace xorg::testing::evemu;
+
+TEST(DevicePool, Reuse)
+{
+  XORG_TESTCASE("An idle device is leased again, a device in use is not");
+
+  DevicePool::Clear();
+
+  Device *first;
+  {
+    DeviceLease lease(TEST_ROOT_DIR "PIXART-USB-OPTICAL-MOUSE.desc");
+    first = &lease.GetDevice();
+  }
+  ASSERT_EQ(DevicePool::GetSize(), 1U);
+
+  {
+    DeviceLease lease(TEST_ROOT_DIR "PIXART-USB-OPTICAL-MOUSE.desc");
+    ASSERT_EQ(&lease.GetDevice(), first);
+
+    DeviceLease other(TEST_ROOT_DIR "PIXART-USB-OPTICAL-MOUSE.desc");
+    ASSERT_NE(&other.GetDevice(), first);
+    ASSERT_EQ(DevicePool::GetSize(), 2U);
+
+    DevicePool::Clear();
+    ASSERT_EQ(DevicePool::GetSize(), 2U) << "Leased devices are kept";
+  }
+
+  DevicePool::Clear();
+  ASSERT_EQ(DevicePool::GetSize(), 0U);
+}
+
+TEST(DevicePool, Reset)
+{
+  XORG_TESTCASE("Buttons held down at the end of a lease are released\n"
+                "for the next one");
+
+  DevicePool::Clear();
+
+  int fd;
+  {
+    DeviceLease lease(TEST_ROOT_DIR "PIXART-USB-OPTICAL-MOUSE.desc");
+    fd = open(lease.GetDevice().GetDeviceNode().c_str(), O_RDONLY | O_NONBLOCK);
+    ASSERT_GE(fd, 0);
+    lease.GetDevice().PlayOne(EV_KEY, BTN_LEFT, 1, true);
+  }
+
+  DeviceLease lease(TEST_ROOT_DIR "PIXART-USB-OPTICAL-MOUSE.desc");
+
+  bool pressed = false, released = false;
+  struct input_event ev;
+  struct pollfd pfd = { fd, POLLIN, 0 };
+  while (poll(&pfd, 1, 100) > 0 && read(fd, &ev, sizeof(ev)) == sizeof(ev)) {
+    if (ev.type == EV_KEY && ev.code == BTN_LEFT) {
+      if (ev.value)
+        pressed = true;
+      else
+        released = true;
+    }
+    ASSERT_FALSE(ev.type == EV_KEY && ev.code == BTN_RIGHT)
+      << "Only buttons down are released";
+  }
+  ASSERT_TRUE(pressed);
+  ASSERT_TRUE(released);
+
+  close(fd);
+}
+
+TEST(DevicePool, ResetAbsolute)
+{
+  XORG_TESTCASE("Absolute axes, including the multitouch axes of every\n"
+                "slot, are back at their minimum for the next lease");
+
+  DevicePool::Clear();
+
+  int fd;
+  {
+    DeviceLease lease(TEST_ROOT_DIR "SynPS2-Synaptics-TouchPad.desc");
+    Device &d = lease.GetDevice();
+    fd = open(d.GetDeviceNode().c_str(), O_RDONLY | O_NONBLOCK);
+    ASSERT_GE(fd, 0);
+    d.PlayOne(EV_ABS, ABS_X, 3000);
+    d.PlayOne(EV_ABS, ABS_MT_SLOT, 1);
+    d.PlayOne(EV_ABS, ABS_MT_TRACKING_ID, 5);
+    d.PlayOne(EV_ABS, ABS_MT_POSITION_X, 3000, true);
+  }
+
+  DeviceLease lease(TEST_ROOT_DIR "SynPS2-Synaptics-TouchPad.desc");
+
+  struct input_absinfo abs;
+  ASSERT_EQ(ioctl(fd, EVIOCGABS(ABS_X), &abs), 0);
+  ASSERT_EQ(abs.value, abs.minimum);
+
+  struct {
+    uint32_t code;
+    int32_t values[2];
+  } slots;
+  slots.code = ABS_MT_POSITION_X;
+  ASSERT_GE(ioctl(fd, EVIOCGMTSLOTS(sizeof(slots)), &slots), 0);
+  ASSERT_EQ(ioctl(fd, EVIOCGABS(ABS_MT_POSITION_X), &abs), 0);
+  ASSERT_EQ(slots.values[1], abs.minimum);
+
+  slots.code = ABS_MT_TRACKING_ID;
+  ASSERT_GE(ioctl(fd, EVIOCGMTSLOTS(sizeof(slots)), &slots), 0);
+  ASSERT_EQ(slots.values[1], -1);
+
+  close(fd);
+}
+
+class DevicePoolTest : public Test {
+public:
+  DevicePoolTest() { SetServerScope(SCOPE_PER_SUITE); }
+};
+
+TEST_F(DevicePoolTest, XDeviceId)
+{
+  XORG_TESTCASE("The X device id of a leased device is found by its\n"
+                "device node and remembered");
+
+  DevicePool::Clear();
+
+  int deviceid;
+  {
+    DeviceLease lease(TEST_ROOT_DIR "PIXART-USB-OPTICAL-MOUSE.desc");
+    deviceid = lease.GetXDeviceId(Display());
+    ASSERT_NE(deviceid, -1);
+
+    DeviceProperties props(Display(), deviceid);
+    ASSERT_EQ(props.GetString("Device Node"), lease.GetDevice().GetDeviceNode());
+  }
+
+  DeviceLease lease(TEST_ROOT_DIR "PIXART-USB-OPTICAL-MOUSE.desc");
+  ASSERT_EQ(lease.GetXDeviceId(Display(), 0), deviceid);
+}
+
+#endif
+
+int main(int argc, char *argv[]) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
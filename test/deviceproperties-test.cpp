@@ -0,0 +1,109 @@
+#include <gtest/gtest.h>
+#include <xorg/gtest/xorg-gtest.h>
+
+#include <X11/Xatom.h>
+#include <X11/extensions/XInput2.h>
+
+using namespace xorg::testing;
+
+/* the virtual core pointer, always present */
+#define VCP_ID 2
+
+class DevicePropertiesTest : public Test {
+public:
+  DevicePropertiesTest() { SetServerScope(SCOPE_PER_SUITE); }
+};
+
+TEST_F(DevicePropertiesTest, Integers)
+{
+  XORG_TESTCASE("Queued integer writes are visible after Flush(),\n"
+                "the existing format is kept");
+
+  DeviceProperties props(Display(), VCP_ID);
+  ASSERT_TRUE(props.Has("Device Enabled"));
+  ASSERT_EQ(props.GetFormat("Device Enabled"), 8);
+  ASSERT_EQ(props.GetIntegers("Device Enabled").size(), 1U);
+  ASSERT_FALSE(props.Has("xorg-gtest integer property"));
+  ASSERT_THROW(props.GetIntegers("xorg-gtest integer property"),
+               std::runtime_error);
+
+  std::vector<long> values;
+  values.push_back(-1);
+  values.push_back(65536);
+  props.SetIntegers("xorg-gtest integer property", values);
+  ASSERT_TRUE(props.Flush());
+
+  props.Invalidate();
+  ASSERT_EQ(props.GetFormat("xorg-gtest integer property"), 32);
+  ASSERT_EQ(props.GetIntegers("xorg-gtest integer property"), values);
+}
+
+TEST_F(DevicePropertiesTest, FloatsAndStrings)
+{
+  XORG_TESTCASE("Float and atom properties round-trip, a type mismatch\n"
+                "throws");
+
+  DeviceProperties props(Display(), VCP_ID);
+
+  std::vector<float> floats;
+  floats.push_back(1.5);
+  floats.push_back(-0.25);
+  props.SetFloats("xorg-gtest float property", floats);
+
+  std::vector<Atom> atoms;
+  atoms.push_back(XA_STRING);
+  props.SetAtoms("xorg-gtest atom property", atoms);
+  ASSERT_TRUE(props.Flush());
+
+  std::vector<std::string> names;
+  names.push_back("xorg-gtest float property");
+  names.push_back("xorg-gtest atom property");
+  props.Invalidate();
+  props.Fetch(names);
+
+  ASSERT_EQ(props.GetFloats("xorg-gtest float property"), floats);
+  ASSERT_EQ(props.GetAtoms("xorg-gtest atom property"), atoms);
+  ASSERT_THROW(props.GetString("xorg-gtest float property"), std::runtime_error);
+}
+
+TEST_F(DevicePropertiesTest, FailedFlush)
+{
+  XORG_TESTCASE("Flush() reports a write to a device that does not exist");
+
+  std::vector<long> values(1, 1);
+  DeviceProperties props(Display(), 1000);
+  props.SetIntegers("xorg-gtest integer property", values);
+  ASSERT_FALSE(props.Flush());
+}
+
+TEST_F(DevicePropertiesTest, WaitForPropertyValue)
+{
+  XORG_TESTCASE("WaitForPropertyValue() returns once another client set\n"
+                "the value, or after the timeout");
+
+  std::vector<long> initial(1, 0);
+  std::vector<long> expected(1, 42);
+
+  DeviceProperties props(Display(), VCP_ID);
+  props.SetIntegers("xorg-gtest waited property", initial);
+  ASSERT_TRUE(props.Flush());
+  ASSERT_FALSE(props.WaitForPropertyValue("xorg-gtest waited property",
+                                          expected, 100));
+
+  ::Display *other = XOpenDisplay(DisplayString(Display()));
+  ASSERT_TRUE(other != NULL);
+  DeviceProperties other_props(other, VCP_ID);
+  other_props.SetIntegers("xorg-gtest waited property", expected);
+  ASSERT_TRUE(other_props.Flush());
+
+  ASSERT_TRUE(props.WaitForPropertyValue("xorg-gtest waited property",
+                                         expected));
+  ASSERT_EQ(props.GetIntegers("xorg-gtest waited property"), expected);
+
+  XCloseDisplay(other);
+}
+
+int main(int argc, char *argv[]) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,92 @@
+#include <gtest/gtest.h>
+#include <xorg/gtest/xorg-gtest.h>
+
+using namespace xorg::testing;
+
+class DisplayCacheTest : public Test {
+public:
+  DisplayCacheTest() { SetServerScope(SCOPE_PER_SUITE); }
+
+  virtual void SetUp() {
+    Test::SetUp();
+    DisplayCache::ResetStatistics();
+  }
+};
+
+TEST_F(DisplayCacheTest, Atoms)
+{
+  XORG_TESTCASE("Atoms are interned once per display, missing atoms of a\n"
+                "list in one batch");
+
+  Atom prop = DisplayCache::GetAtom(Display(), "xorg-gtest cached atom");
+  ASSERT_NE(prop, (Atom)None);
+  ASSERT_EQ(DisplayCache::GetMisses(), 1UL);
+  ASSERT_EQ(DisplayCache::GetHits(), 0UL);
+
+  ASSERT_EQ(DisplayCache::GetAtom(Display(), "xorg-gtest cached atom"), prop);
+  ASSERT_EQ(DisplayCache::GetHits(), 1UL);
+
+  std::vector<std::string> names;
+  names.push_back("xorg-gtest cached atom");
+  names.push_back("WM_NAME");
+  names.push_back("xorg-gtest other atom");
+
+  std::vector<Atom> atoms;
+  DisplayCache::GetAtoms(Display(), names, &atoms);
+  ASSERT_EQ(atoms.size(), 3U);
+  ASSERT_EQ(atoms[0], prop);
+  ASSERT_EQ(atoms[1], XInternAtom(Display(), "WM_NAME", True));
+  ASSERT_EQ(DisplayCache::GetHits(), 2UL);
+  ASSERT_EQ(DisplayCache::GetMisses(), 3UL);
+
+  ASSERT_EQ(DisplayCache::GetAtomName(Display(), atoms[2]), "xorg-gtest other atom");
+  ASSERT_EQ(DisplayCache::GetHits(), 3UL);
+}
+
+TEST_F(DisplayCacheTest, Extensions)
+{
+  XORG_TESTCASE("Extensions are queried once per display");
+
+  int opcode, event_base, error_base;
+  ASSERT_TRUE(DisplayCache::QueryExtension(Display(), "XInputExtension",
+                                           &opcode, &event_base, &error_base));
+  ASSERT_EQ(DisplayCache::GetMisses(), 1UL);
+
+  int expected_opcode;
+  XQueryExtension(Display(), "XInputExtension", &expected_opcode, &event_base,
+                  &error_base);
+  ASSERT_EQ(opcode, expected_opcode);
+
+  ASSERT_TRUE(DisplayCache::QueryExtension(Display(), "XInputExtension",
+                                           NULL, NULL, NULL));
+  ASSERT_FALSE(DisplayCache::QueryExtension(Display(), "No such extension",
+                                            NULL, NULL, NULL));
+  ASSERT_FALSE(DisplayCache::QueryExtension(Display(), "No such extension",
+                                            NULL, NULL, NULL));
+  ASSERT_EQ(DisplayCache::GetHits(), 2UL);
+  ASSERT_EQ(DisplayCache::GetMisses(), 2UL);
+}
+
+TEST_F(DisplayCacheTest, DroppedOnClose)
+{
+  XORG_TESTCASE("The cache of a display is dropped when it is closed");
+
+  ::Display *dpy = XOpenDisplay(DisplayString(Display()));
+  ASSERT_TRUE(dpy != NULL);
+  DisplayCache::GetAtom(dpy, "WM_NAME");
+  XCloseDisplay(dpy);
+
+  /* likely the same address as before */
+  dpy = XOpenDisplay(DisplayString(Display()));
+  ASSERT_TRUE(dpy != NULL);
+  DisplayCache::GetAtom(dpy, "WM_NAME");
+  XCloseDisplay(dpy);
+
+  ASSERT_EQ(DisplayCache::GetHits(), 0UL);
+  ASSERT_EQ(DisplayCache::GetMisses(), 2UL);
+}
+
+int main(int argc, char *argv[]) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
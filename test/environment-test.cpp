@@ -0,0 +1,215 @@
+#include <csignal>
+#include <fstream>
+#include <sstream>
+#include <unistd.h>
+
+#include <gtest/gtest.h>
+#include <xorg/gtest/xorg-gtest.h>
+
+#include <X11/Xatom.h>
+#include <X11/extensions/XInput2.h>
+
+using namespace xorg::testing;
+
+#define VIRTUAL_CORE_POINTER_ID 2
+
+/* Expose the SetUp/TearDown normally called by gtest */
+class TestEnvironment : public Environment {
+public:
+  TestEnvironment() {
+    SetConfigFile(DUMMY_CONF_PATH);
+    SetLogFile(LOGFILE_DIR "/Xorg-environment-test.log");
+  }
+
+  void SetUp() { Environment::SetUp(); }
+  void TearDown() { Environment::TearDown(); }
+};
+
+TEST(Environment, ResetClients)
+{
+  XORG_TESTCASE("Reset() kills leftover clients and restores the window\n"
+                "and device state");
+
+  TestEnvironment env;
+  env.SetResetMode(Environment::RESET_CLIENTS);
+  env.SetUp();
+
+  ::Display *dpy = XOpenDisplay(NULL);
+  ASSERT_TRUE(dpy != NULL);
+
+  XCreateSimpleWindow(dpy, DefaultRootWindow(dpy), 0, 0, 10, 10, 0, 0, 0);
+  XWarpPointer(dpy, None, DefaultRootWindow(dpy), 0, 0, 0, 0, 3, 7);
+
+  Atom prop = XInternAtom(dpy, "xorg-gtest test property", False);
+  unsigned char data = 1;
+  XIChangeProperty(dpy, VIRTUAL_CORE_POINTER_ID, prop, XA_INTEGER, 8,
+                   PropModeReplace, &data, 1);
+  XSync(dpy, False);
+
+  /* dpy is dead after this */
+  ASSERT_TRUE(env.Reset());
+
+  ::Display *check = XOpenDisplay(NULL);
+  ASSERT_TRUE(check != NULL);
+
+  Window root, parent, *children;
+  unsigned int nchildren;
+  XQueryTree(check, DefaultRootWindow(check), &root, &parent, &children, &nchildren);
+  ASSERT_EQ(nchildren, 0U);
+  XFree(children);
+
+  int nprops;
+  Atom *props = XIListProperties(check, VIRTUAL_CORE_POINTER_ID, &nprops);
+  for (int i = 0; i < nprops; i++)
+    ASSERT_NE(props[i], prop);
+  XFree(props);
+
+  XCloseDisplay(check);
+  env.TearDown();
+}
+
+TEST(Environment, ResetRegenerate)
+{
+  XORG_TESTCASE("Reset() regenerates the server, leftover windows are gone");
+
+  TestEnvironment env;
+  env.SetResetMode(Environment::RESET_REGENERATE);
+  env.SetUp();
+
+  ::Display *dpy = XOpenDisplay(NULL);
+  ASSERT_TRUE(dpy != NULL);
+  XCreateSimpleWindow(dpy, DefaultRootWindow(dpy), 0, 0, 10, 10, 0, 0, 0);
+  XCloseDisplay(dpy);
+
+  ASSERT_TRUE(env.Reset());
+
+  ::Display *check = XOpenDisplay(NULL);
+  ASSERT_TRUE(check != NULL);
+
+  Window root, parent, *children;
+  unsigned int nchildren;
+  XQueryTree(check, DefaultRootWindow(check), &root, &parent, &children, &nchildren);
+  ASSERT_EQ(nchildren, 0U);
+  XFree(children);
+
+  XCloseDisplay(check);
+  env.TearDown();
+}
+
+TEST(Environment, LazyStart)
+{
+  XORG_TESTCASE("A lazy environment starts the server on RequireServer()");
+
+  TestEnvironment env;
+  env.SetLazyStart(true);
+  env.SetUp();
+
+  ::Display *dpy = XOpenDisplay(NULL);
+  ASSERT_TRUE(dpy == NULL);
+
+  Environment::RequireServer();
+  dpy = XOpenDisplay(NULL);
+  ASSERT_TRUE(dpy != NULL);
+  XCloseDisplay(dpy);
+
+  /* second call is a noop */
+  Environment::RequireServer();
+
+  env.TearDown();
+}
+
+static void* assign_server(void *data) {
+  Environment *env = static_cast<Environment*>(data);
+  return &env->AssignServer();
+}
+
+TEST(Environment, MultipleServers)
+{
+  XORG_TESTCASE("AddServer() adds servers that start with the environment");
+
+  TestEnvironment env;
+  XServer &second = env.AddServer("second", 134);
+  ASSERT_THROW(env.AddServer("second", 135), std::runtime_error);
+  env.SetUp();
+
+  ASSERT_EQ(env.GetServerCount(), 2U);
+  ASSERT_EQ(&env.GetServer(1), &second);
+  ASSERT_EQ(&env.GetServer("second"), &second);
+  ASSERT_EQ(&env.GetServer("default"), &env.GetServer(0));
+  ASSERT_THROW(env.GetServer(2), std::runtime_error);
+  ASSERT_THROW(env.GetServer("third"), std::runtime_error);
+
+  ::Display *dpy = XOpenDisplay(second.GetDisplayString().c_str());
+  ASSERT_TRUE(dpy != NULL);
+  XCloseDisplay(dpy);
+
+  /* one server per thread, round-robin */
+  XServer *mine = &env.AssignServer();
+  ASSERT_EQ(&env.AssignServer(), mine);
+
+  pthread_t thread;
+  void *theirs;
+  ASSERT_EQ(pthread_create(&thread, NULL, assign_server, &env), 0);
+  ASSERT_EQ(pthread_join(thread, &theirs), 0);
+  ASSERT_NE(theirs, mine);
+
+  env.TearDown();
+}
+
+TEST(Environment, RecoverCrashedServer)
+{
+  XORG_TESTCASE("Recover() restarts a server that died and keeps the log\n"
+                "of the dead server");
+
+  TestEnvironment env;
+  env.SetUp();
+
+  std::string crash_log = env.GetLogFile() + ".crash";
+  unlink(crash_log.c_str());
+
+  ASSERT_FALSE(env.Recover()) << "A running server must not be restarted";
+
+  /* the server writes its pid to the lock file of its display */
+  std::stringstream lock_file;
+  lock_file << "/tmp/.X" << env.GetDisplayNumber() << "-lock";
+  pid_t pid = 0;
+  std::ifstream(lock_file.str().c_str()) >> pid;
+  ASSERT_GT(pid, 0);
+  ASSERT_EQ(kill(pid, SIGKILL), 0);
+
+  /* the server takes a moment to die */
+  bool recovered = false;
+  for (int i = 0; i < 100 && !recovered; i++) {
+    usleep(10000);
+    recovered = env.Recover();
+  }
+  ASSERT_TRUE(recovered);
+  ASSERT_EQ(access(crash_log.c_str(), F_OK), 0);
+
+  ::Display *dpy = XOpenDisplay(NULL);
+  ASSERT_TRUE(dpy != NULL);
+  XCloseDisplay(dpy);
+
+  env.TearDown();
+}
+
+TEST(Environment, RecoverKilledServer)
+{
+  XORG_TESTCASE("Recover() leaves a server stopped through Kill() alone");
+
+  TestEnvironment env;
+  env.SetUp();
+
+  env.Kill();
+  ASSERT_FALSE(env.Recover());
+
+  ::Display *dpy = XOpenDisplay(NULL);
+  ASSERT_TRUE(dpy == NULL);
+
+  env.TearDown();
+}
+
+int main(int argc, char *argv[]) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
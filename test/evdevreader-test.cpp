@@ -0,0 +1,77 @@
+#include <gtest/gtest.h>
+#include <xorg/gtest/xorg-gtest.h>
+
+#ifdef HAVE_EVEMU
+#include <cstring>
+
+using namespace xorg::testing::evemu;
+
+TEST(EvdevReader, Readback)
+{
+  XORG_TESTCASE("Injected events are read back from the event node with\n"
+                "their kernel timestamps");
+
+  Device d(TEST_ROOT_DIR "PIXART-USB-OPTICAL-MOUSE.desc");
+  EvdevReader reader(d);
+
+  reader.Inject(EV_KEY, BTN_LEFT, 1, true);
+
+  struct input_event events[3];
+  memset(events, 0, sizeof(events));
+  events[0].type = EV_REL;
+  events[0].code = REL_X;
+  events[0].value = 10;
+  events[1].type = EV_REL;
+  events[1].code = REL_Y;
+  events[1].value = -5;
+  events[2].type = EV_SYN;
+  events[2].code = SYN_REPORT;
+  reader.Inject(events, 3);
+
+  reader.Inject(EV_KEY, BTN_LEFT, 0, true);
+
+  std::string mismatch;
+  ASSERT_TRUE(reader.Verify(&mismatch)) << mismatch;
+  ASSERT_EQ(reader.GetEvents().size(), 7U);
+  ASSERT_EQ(d.GetPlaybackStats().frames, 0U)
+    << "Injecting must not change the playback stats";
+
+  for (size_t i = 0; i < reader.GetEvents().size(); i++)
+    ASSERT_NE(reader.GetEvents()[i].time.tv_sec, 0);
+
+  EvdevReader::LatencyStats stats = reader.GetLatencyStats();
+  ASSERT_EQ(stats.events, 7U);
+  ASSERT_LE(stats.mean_us, stats.max_us);
+  ASSERT_LT(stats.max_us, 1000000);
+}
+
+TEST(EvdevReader, Mismatch)
+{
+  XORG_TESTCASE("Events the kernel did not deliver as injected are\n"
+                "reported");
+
+  Device d(TEST_ROOT_DIR "PIXART-USB-OPTICAL-MOUSE.desc");
+  EvdevReader reader(d);
+
+  /* the second press does not change the state and is dropped */
+  reader.Inject(EV_KEY, BTN_LEFT, 1, true);
+  reader.Inject(EV_KEY, BTN_LEFT, 1, true);
+
+  std::string mismatch;
+  ASSERT_FALSE(reader.Verify(&mismatch, 100));
+  ASSERT_FALSE(mismatch.empty());
+  ASSERT_EQ(reader.GetLatencyStats().events, 2U);
+
+  reader.Clear();
+  ASSERT_TRUE(reader.GetEvents().empty());
+
+  reader.Inject(EV_KEY, BTN_LEFT, 0, true);
+  ASSERT_TRUE(reader.Verify(&mismatch)) << mismatch;
+}
+
+#endif
+
+int main(int argc, char *argv[]) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,186 @@
+#include <gtest/gtest.h>
+#include <gtest/gtest-spi.h>
+#include <xorg/gtest/xorg-gtest.h>
+
+#include <X11/Xatom.h>
+
+using namespace xorg::testing;
+
+/* Root window properties outlive the client that set them, so they tell
+ * whether two tests shared a server */
+static const char *property_name = "xorg-gtest scope property";
+
+static void set_property(::Display *dpy) {
+  Atom prop = XInternAtom(dpy, property_name, False);
+  unsigned char data = 1;
+  XChangeProperty(dpy, DefaultRootWindow(dpy), prop, XA_INTEGER, 8,
+                  PropModeReplace, &data, 1);
+  XSync(dpy, False);
+}
+
+static bool has_property(::Display *dpy) {
+  Atom prop = XInternAtom(dpy, property_name, True);
+  if (prop == None)
+    return false;
+
+  int nprops;
+  Atom *props = XListProperties(dpy, DefaultRootWindow(dpy), &nprops);
+  bool found = false;
+  for (int i = 0; i < nprops; i++)
+    if (props[i] == prop)
+      found = true;
+  XFree(props);
+
+  return found;
+}
+
+class PerSuiteTest : public Test {
+public:
+  PerSuiteTest() { SetServerScope(SCOPE_PER_SUITE); }
+};
+
+TEST_F(PerSuiteTest, SetProperty)
+{
+  XORG_TESTCASE("SCOPE_PER_SUITE starts a server for the test case");
+
+  ASSERT_TRUE(Server() != NULL);
+  ASSERT_EQ(Server()->GetState(), Process::RUNNING);
+  set_property(Display());
+}
+
+TEST_F(PerSuiteTest, PropertyKept)
+{
+  XORG_TESTCASE("SCOPE_PER_SUITE shares the server between the tests");
+
+  set_property(Display());
+  XServer *server = Server();
+
+  /* what happens between two tests of the test case */
+  TearDown();
+  SetUp();
+
+  ASSERT_EQ(Server(), server);
+  ASSERT_TRUE(has_property(Display()));
+}
+
+class PerTestTest : public Test {
+public:
+  PerTestTest() { SetServerScope(SCOPE_PER_TEST); }
+};
+
+TEST_F(PerTestTest, SetProperty)
+{
+  XORG_TESTCASE("SCOPE_PER_TEST starts a server for the test");
+
+  ASSERT_TRUE(Server() != NULL);
+  ASSERT_FALSE(has_property(Display()));
+  set_property(Display());
+}
+
+TEST_F(PerTestTest, PropertyGone)
+{
+  XORG_TESTCASE("SCOPE_PER_TEST starts a new server for each test");
+
+  ASSERT_FALSE(has_property(Display()));
+}
+
+class ConfiguredTest : public Test {
+public:
+  ConfiguredTest() { SetServerScope(SCOPE_PER_TEST); }
+
+  virtual void ConfigureServer(XServer &server) {
+    server.SetDisplayNumber(135);
+  }
+};
+
+TEST_F(ConfiguredTest, DisplayNumber)
+{
+  XORG_TESTCASE("ConfigureServer() is called before the server starts");
+
+  ASSERT_EQ(Server()->GetDisplayNumber(), 135U);
+  ASSERT_EQ(std::string(DisplayString(Display())), ":135");
+}
+
+class PooledTest : public Test {
+public:
+  PooledTest() {
+    SetServerScope(SCOPE_PER_SUITE);
+    SetConnectionPooling(true);
+  }
+};
+
+static ::Display *pooled_display;
+
+TEST_F(PooledTest, LeaveState)
+{
+  XORG_TESTCASE("A pooled connection is kept after the test");
+
+  pooled_display = Display();
+  XSelectInput(Display(), DefaultRootWindow(Display()), PropertyChangeMask);
+  XCreateSimpleWindow(Display(), DefaultRootWindow(Display()), 0, 0, 10, 10,
+                      0, 0, 0);
+  set_property(Display());
+}
+
+TEST_F(PooledTest, StateCleared)
+{
+  XORG_TESTCASE("A pooled connection is reused after its state was reset");
+
+  ASSERT_EQ(Display(), pooled_display);
+
+  XWindowAttributes attributes;
+  XGetWindowAttributes(Display(), DefaultRootWindow(Display()), &attributes);
+  ASSERT_EQ(attributes.your_event_mask, NoEventMask);
+
+  Window root, parent, *children;
+  unsigned int nchildren;
+  XQueryTree(Display(), DefaultRootWindow(Display()), &root, &parent,
+             &children, &nchildren);
+  ASSERT_EQ(nchildren, 0U);
+  XFree(children);
+
+  ASSERT_EQ(XPending(Display()), 0);
+}
+
+class LeakCheckTest : public Test {
+public:
+  LeakCheckTest() {
+    SetServerScope(SCOPE_PER_SUITE);
+    SetLeakCheck(LEAK_CHECK_FAIL);
+  }
+};
+
+TEST_F(LeakCheckTest, ResourcesFreedOnClose)
+{
+  XORG_TESTCASE("Resources of Display() are freed when it is closed and\n"
+                "not reported as leaks");
+
+  XCreateSimpleWindow(Display(), DefaultRootWindow(Display()), 0, 0, 10, 10,
+                      0, 0, 0);
+  XCreatePixmap(Display(), DefaultRootWindow(Display()), 64, 64,
+                DefaultDepth(Display(), 0));
+  XSync(Display(), False);
+}
+
+TEST_F(LeakCheckTest, LeakReported)
+{
+  XORG_TESTCASE("Resources still held by another client when the test\n"
+                "ends are reported as leaks");
+
+  ::Display *other = XOpenDisplay(DisplayString(Display()));
+  ASSERT_TRUE(other != NULL);
+  XCreatePixmap(other, DefaultRootWindow(other), 64, 64,
+                DefaultDepth(other, 0));
+  XSync(other, False);
+
+  /* the check runs in TearDown(), run it here to catch its failure. The
+   * second TearDown() after the test finds nothing left to do. */
+  EXPECT_NONFATAL_FAILURE(TearDown(), "Server resources grew during the test");
+
+  XCloseDisplay(other);
+}
+
+int main(int argc, char *argv[]) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,131 @@
+#include <gtest/gtest.h>
+#include <xorg/gtest/xorg-gtest.h>
+
+#ifdef HAVE_EVEMU
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+
+#include <stdexcept>
+
+using namespace xorg::testing::evemu;
+
+static int count_events(const GestureGenerator &g, unsigned int frame,
+                        int type, int code, int value) {
+  const struct input_event *events = g.GetEvents();
+  const uint32_t *offsets = g.GetFrameOffsets();
+  int count = 0;
+
+  for (uint32_t i = offsets[frame]; i < offsets[frame + 1]; i++)
+    if (events[i].type == type && events[i].code == code &&
+        events[i].value == value)
+      count++;
+
+  return count;
+}
+
+TEST(GestureGenerator, RequiresMultitouch)
+{
+  XORG_TESTCASE("Gestures need a device supporting the MT protocol B");
+
+  Device d(TEST_ROOT_DIR "PIXART-USB-OPTICAL-MOUSE.desc");
+  ASSERT_THROW(GestureGenerator g(d), std::runtime_error);
+}
+
+TEST(GestureGenerator, Frames)
+{
+  XORG_TESTCASE("A gesture has one frame per sample plus a lift-off\n"
+                "frame, tracking IDs are assigned per touch");
+
+  Device d(TEST_ROOT_DIR "SynPS2-Synaptics-TouchPad.desc");
+  GestureGenerator g(d);
+  ASSERT_EQ(g.GetSlotCount(), 2U);
+  ASSERT_EQ(g.GetSampleRate(), 100U);
+
+  g.Scroll(0.5, 0.2, 0, 0.5, 100);
+  ASSERT_EQ(g.GetFrameCount(), 12U);
+  ASSERT_EQ(g.GetFrameOffsets()[g.GetFrameCount()], g.GetEventCount());
+
+  ASSERT_EQ(count_events(g, 0, EV_ABS, ABS_MT_TRACKING_ID, 0), 1);
+  ASSERT_EQ(count_events(g, 0, EV_ABS, ABS_MT_TRACKING_ID, 1), 1);
+  ASSERT_EQ(count_events(g, 0, EV_KEY, BTN_TOOL_DOUBLETAP, 1), 1);
+  ASSERT_EQ(count_events(g, 0, EV_KEY, BTN_TOUCH, 1), 1);
+  ASSERT_EQ(count_events(g, 5, EV_ABS, ABS_MT_TRACKING_ID, 0), 0);
+  ASSERT_EQ(count_events(g, 11, EV_ABS, ABS_MT_TRACKING_ID, -1), 2);
+  ASSERT_EQ(count_events(g, 11, EV_KEY, BTN_TOOL_DOUBLETAP, 0), 1);
+
+  /* the last frame is 110 ms after the first */
+  const struct input_event *last = &g.GetEvents()[g.GetFrameOffsets()[11]];
+  ASSERT_EQ(last->time.tv_sec, 0);
+  ASSERT_EQ(last->time.tv_usec, 110000);
+
+  /* the first finger moves from y = 0.2 to y = 0.7 */
+  int min, max;
+  d.GetAbsData(ABS_MT_POSITION_Y, &min, &max);
+  ASSERT_EQ(count_events(g, 0, EV_ABS, ABS_MT_POSITION_Y,
+                         min + (int)(0.2 * (max - min) + 0.5)), 2);
+  ASSERT_EQ(count_events(g, 10, EV_ABS, ABS_MT_POSITION_Y,
+                         min + (int)(0.7 * (max - min) + 0.5)), 2);
+
+  g.Tap(1, 0.5, 0.5);
+  ASSERT_EQ(count_events(g, 12, EV_ABS, ABS_MT_TRACKING_ID, 2), 1);
+
+  ASSERT_THROW(g.Pinch(3, 0.5, 0.5, 0.3, 0.1, 100), std::runtime_error);
+
+  g.Clear();
+  ASSERT_EQ(g.GetFrameCount(), 0U);
+  ASSERT_EQ(g.GetEventCount(), 0U);
+}
+
+TEST(GestureGenerator, BufferFull)
+{
+  XORG_TESTCASE("Generating more events than the buffer holds throws and\n"
+                "leaves the gestures generated before");
+
+  Device d(TEST_ROOT_DIR "SynPS2-Synaptics-TouchPad.desc");
+  GestureGenerator g(d, 64);
+  g.Tap(1, 0.5, 0.5);
+  unsigned int nframes = g.GetFrameCount();
+  unsigned int nevents = g.GetEventCount();
+
+  ASSERT_THROW(g.Rotate(2, 0.5, 0.5, 0.2, 3.14, 1000), std::runtime_error);
+  ASSERT_EQ(g.GetFrameCount(), nframes) << "Partial gesture left behind";
+  ASSERT_EQ(g.GetEventCount(), nevents) << "Partial gesture left behind";
+}
+
+TEST(GestureGenerator, Play)
+{
+  XORG_TESTCASE("Generated gestures reach the device node");
+
+  Device d(TEST_ROOT_DIR "SynPS2-Synaptics-TouchPad.desc");
+  int fd = open(d.GetDeviceNode().c_str(), O_RDONLY | O_NONBLOCK);
+  ASSERT_GE(fd, 0);
+
+  GestureGenerator g(d);
+  g.Pinch(2, 0.5, 0.5, 0.1, 0.3, 50);
+  g.Play();
+  ASSERT_EQ(d.GetPlaybackStats().frames, g.GetFrameCount());
+
+  int touches = 0, releases = 0;
+  struct input_event ev;
+  struct pollfd pfd = { fd, POLLIN, 0 };
+  while (poll(&pfd, 1, 100) > 0 && read(fd, &ev, sizeof(ev)) == sizeof(ev)) {
+    if (ev.type == EV_ABS && ev.code == ABS_MT_TRACKING_ID) {
+      if (ev.value == -1)
+        releases++;
+      else
+        touches++;
+    }
+  }
+  ASSERT_EQ(touches, 2);
+  ASSERT_EQ(releases, 2);
+
+  close(fd);
+}
+
+#endif
+
+int main(int argc, char *argv[]) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
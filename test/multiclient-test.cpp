@@ -0,0 +1,83 @@
+#include <gtest/gtest.h>
+#include <xorg/gtest/xorg-gtest.h>
+
+using namespace xorg::testing;
+
+TEST(LatencyHistogram, Buckets)
+{
+  XORG_TESTCASE("Latencies are counted in power-of-two buckets");
+
+  LatencyHistogram histogram;
+  ASSERT_EQ(histogram.GetCount(), 0UL);
+  ASSERT_EQ(histogram.GetPercentile(50), 0UL);
+
+  histogram.Add(0);
+  histogram.Add(1);
+  histogram.Add(3);
+  histogram.Add(1000);
+
+  ASSERT_EQ(histogram.GetCount(), 4UL);
+  ASSERT_EQ(histogram.GetBucket(0), 2UL);
+  ASSERT_EQ(histogram.GetBucket(1), 1UL);
+  ASSERT_EQ(histogram.GetBucket(9), 1UL);
+  ASSERT_EQ(histogram.GetMin(), 0UL);
+  ASSERT_EQ(histogram.GetMax(), 1000UL);
+  ASSERT_DOUBLE_EQ(histogram.GetMean(), 251.0);
+
+  ASSERT_EQ(histogram.GetPercentile(50), 1UL);
+  ASSERT_EQ(histogram.GetPercentile(75), 3UL);
+  /* capped by the maximum, not the bucket limit of 1023 */
+  ASSERT_EQ(histogram.GetPercentile(100), 1000UL);
+}
+
+TEST(LatencyHistogram, Merge)
+{
+  XORG_TESTCASE("Merging adds the counts and keeps min and max");
+
+  LatencyHistogram a, b;
+  a.Add(10);
+  b.Add(5);
+  b.Add(100);
+  a.Merge(b);
+
+  ASSERT_EQ(a.GetCount(), 3UL);
+  ASSERT_EQ(a.GetMin(), 5UL);
+  ASSERT_EQ(a.GetMax(), 100UL);
+  ASSERT_EQ(a.GetBucket(3), 1UL);
+}
+
+class Stress : public MultiClientTest {
+public:
+  Stress() {
+    SetServerScope(SCOPE_PER_TEST);
+    SetMaxClients(512);
+  }
+};
+
+TEST_F(Stress, ConcurrentClients)
+{
+  XORG_TESTCASE("All clients send their requests concurrently");
+
+  AddRequest(REQUEST_SYNC);
+  AddRequest(REQUEST_INTERN_ATOM);
+  AddRequest(REQUEST_QUERY_POINTER);
+  AddRequest(REQUEST_CHANGE_PROPERTY);
+  AddRequest(REQUEST_CREATE_WINDOW);
+
+  ASSERT_EQ(OpenClients(300), 300U);
+  ASSERT_EQ(GetClientCount(), 300U);
+  ASSERT_EQ(GetConnectLatency().GetCount(), 300UL);
+
+  Run(20);
+
+  ASSERT_EQ(GetFailedClients(), 0U);
+  for (unsigned int i = 0; i < GetClientCount(); i++)
+    ASSERT_EQ(GetLatency(i).GetCount(), 20UL);
+  ASSERT_EQ(GetTotalLatency().GetCount(), 300UL * 20);
+}
+
+int main(int argc, char *argv[]) {
+  XInitThreads();
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,139 @@
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+#include <gtest/gtest.h>
+#include <xorg/gtest/xorg-gtest.h>
+
+using namespace xorg::testing;
+
+static std::string read_file(const std::string &path)
+{
+  std::ifstream file(path.c_str());
+  std::stringstream s;
+  s << file.rdbuf();
+  return s.str();
+}
+
+TEST(XorgConfig, DefaultProfile)
+{
+  XORG_TESTCASE("The default profile only contains the dummy layout");
+
+  XorgConfig config;
+  std::string contents = config.GetContents();
+
+  ASSERT_NE(contents.find("Driver \"dummy\""), std::string::npos);
+  ASSERT_EQ(contents.find("ServerFlags"), std::string::npos);
+  ASSERT_EQ(contents.find("Extensions"), std::string::npos);
+  ASSERT_EQ(contents.find("Module"), std::string::npos);
+}
+
+TEST(XorgConfig, MinimalProfile)
+{
+  XORG_TESTCASE("The minimal profile disables hotplugging");
+
+  XorgConfig config(XorgConfig::PROFILE_MINIMAL);
+  std::string contents = config.GetContents();
+
+  ASSERT_NE(contents.find("Option \"AutoAddDevices\" \"off\""), std::string::npos);
+  ASSERT_NE(contents.find("Disable \"glx\""), std::string::npos);
+  ASSERT_NE(contents.find("Option \"Composite\" \"Disable\""), std::string::npos);
+
+  config.LoadModule("glx");
+  contents = config.GetContents();
+  ASSERT_EQ(contents.find("Disable \"glx\""), std::string::npos);
+  ASSERT_NE(contents.find("Load \"glx\""), std::string::npos);
+}
+
+TEST(XorgConfig, InputDevices)
+{
+  XORG_TESTCASE("Input devices are added to the layout");
+
+  XorgConfig config;
+  ASSERT_THROW(config.SetInputDeviceOption("--device--", "Device", "/dev/null"),
+               std::runtime_error);
+
+  config.AddInputDevice("--device--", "evdev");
+  config.SetInputDeviceOption("--device--", "Device", "/dev/null");
+  std::string contents = config.GetContents();
+
+  ASSERT_NE(contents.find("Identifier \"--device--\""), std::string::npos);
+  ASSERT_NE(contents.find("Option \"Device\" \"/dev/null\""), std::string::npos);
+  ASSERT_NE(contents.find("InputDevice \"--device--\""), std::string::npos);
+}
+
+TEST(XorgConfig, WriteConfigCache)
+{
+  XORG_TESTCASE("Identical configurations are written to the same file");
+
+  XorgConfig config(XorgConfig::PROFILE_MINIMAL);
+  XorgConfig other(XorgConfig::PROFILE_MINIMAL);
+
+  std::string path = config.WriteConfig(LOGFILE_DIR);
+  ASSERT_EQ(path, config.GetConfigPath());
+  ASSERT_EQ(read_file(path), config.GetContents());
+  ASSERT_EQ(other.WriteConfig(LOGFILE_DIR), path);
+
+  other.SetExtension("Composite", true);
+  ASSERT_NE(other.WriteConfig(LOGFILE_DIR), path);
+
+  unlink(path.c_str());
+  unlink(other.GetConfigPath().c_str());
+}
+
+TEST(XorgConfig, WriteConfigUntrusted)
+{
+  XORG_TESTCASE("Config files with other contents or writable by others\n"
+                "are replaced, the default directory is private");
+
+  XorgConfig config(XorgConfig::PROFILE_MINIMAL);
+  std::string path = config.WriteConfig(LOGFILE_DIR);
+
+  std::ofstream(path.c_str()) << "Section \"Files\"\n"
+                                 "    ModulePath \"/tmp\"\n"
+                                 "EndSection\n";
+  ASSERT_EQ(config.WriteConfig(LOGFILE_DIR), path);
+  ASSERT_EQ(read_file(path), config.GetContents());
+
+  ASSERT_EQ(chmod(path.c_str(), 0666), 0);
+  ASSERT_EQ(config.WriteConfig(LOGFILE_DIR), path);
+  struct stat st;
+  ASSERT_EQ(stat(path.c_str(), &st), 0);
+  ASSERT_EQ(st.st_mode & 022, 0U);
+
+  unlink(path.c_str());
+
+  path = config.WriteConfig();
+  std::string dir = path.substr(0, path.rfind('/'));
+  ASSERT_EQ(stat(dir.c_str(), &st), 0);
+  ASSERT_EQ(st.st_uid, geteuid());
+  ASSERT_EQ(st.st_mode & 077, 0U);
+}
+
+TEST(XorgConfig, StartServer)
+{
+  XORG_TESTCASE("A server starts with the minimal profile");
+
+  XorgConfig config(XorgConfig::PROFILE_MINIMAL);
+
+  XServer server;
+  server.SetOption("-logfile", LOGFILE_DIR "/Xorg-xorgconfig.log");
+  server.SetOption("-config", config.WriteConfig());
+  server.Start();
+  ASSERT_EQ(server.GetState(), Process::RUNNING);
+
+  ::Display *dpy = XOpenDisplay(server.GetDisplayString().c_str());
+  ASSERT_TRUE(dpy != NULL);
+  XCloseDisplay(dpy);
+
+  ASSERT_TRUE(server.Terminate());
+  server.RemoveLogFile();
+}
+
+int main(int argc, char *argv[]) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,202 @@
+#include <time.h>
+
+#include <iostream>
+#include <sstream>
+
+#include <gtest/gtest.h>
+#include <xorg/gtest/xorg-gtest.h>
+
+using namespace xorg::testing;
+
+/**
+ * Server startup benchmarks. These are not run as part of make check,
+ * run ./xserver-benchmark manually. Each benchmark prints the mean time
+ * in milliseconds and records it as a test property for --gtest_output.
+ */
+
+static const int iterations = 10;
+
+static double now_ms(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0;
+}
+
+static void report(const std::string &name, double total_ms)
+{
+  double mean = total_ms / iterations;
+
+  std::cout << "[ BENCHMARK] " << name << ": " << mean << " ms mean over "
+            << iterations << " runs\n";
+
+  std::stringstream s;
+  s << mean;
+  ::testing::Test::RecordProperty(name.c_str(), s.str().c_str());
+}
+
+/* Start a server, connect to it and shut it down again. Returns the time
+ * until the first connection succeeded */
+static double time_startup(const std::string &config, bool prebind = false)
+{
+  XServer server;
+  server.SetPrebindSocket(prebind);
+  server.SetOption("-logfile", LOGFILE_DIR "/Xorg-benchmark.log");
+  server.SetOption("-config", config);
+  server.SetOption("-noreset", "");
+
+  double start = now_ms();
+  server.Start();
+  ::Display *dpy = XOpenDisplay(server.GetDisplayString().c_str());
+  double elapsed = now_ms() - start;
+
+  EXPECT_TRUE(dpy != NULL);
+  if (dpy)
+    XCloseDisplay(dpy);
+
+  server.Terminate(3000);
+  server.RemoveLogFile();
+
+  return elapsed;
+}
+
+TEST(XServerBenchmark, StartupDummyConf)
+{
+  double total = 0;
+  for (int i = 0; i < iterations; i++)
+    total += time_startup(DUMMY_CONF_PATH);
+  report("startup-dummy-conf", total);
+}
+
+TEST(XServerBenchmark, StartupDefaultProfile)
+{
+  XorgConfig config(XorgConfig::PROFILE_DEFAULT);
+  std::string path = config.WriteConfig();
+
+  double total = 0;
+  for (int i = 0; i < iterations; i++)
+    total += time_startup(path);
+  report("startup-default-profile", total);
+}
+
+TEST(XServerBenchmark, StartupMinimalProfile)
+{
+  XorgConfig config(XorgConfig::PROFILE_MINIMAL);
+  std::string path = config.WriteConfig();
+
+  /* interleaved with dummy.conf, so both see the same system load */
+  double total = 0, total_dummy = 0;
+  for (int i = 0; i < iterations; i++) {
+    total_dummy += time_startup(DUMMY_CONF_PATH);
+    total += time_startup(path);
+  }
+  report("startup-minimal-profile", total);
+  report("startup-minimal-profile-saving", total_dummy - total);
+}
+
+TEST(XServerBenchmark, StartupPrebindSocket)
+{
+  /* interleaved with SIGUSR1 startup, so both see the same system load */
+  double total = 0, total_sigusr1 = 0;
+  for (int i = 0; i < iterations; i++) {
+    total_sigusr1 += time_startup(DUMMY_CONF_PATH, false);
+    total += time_startup(DUMMY_CONF_PATH, true);
+  }
+  report("startup-prebind-socket", total);
+  report("startup-prebind-socket-saving", total_sigusr1 - total);
+}
+
+TEST(XServerBenchmark, Restart)
+{
+  XServer server;
+  server.SetOption("-logfile", LOGFILE_DIR "/Xorg-benchmark.log");
+  server.SetOption("-config", DUMMY_CONF_PATH);
+  server.SetOption("-noreset", "");
+  server.Start();
+
+  double total = 0;
+  for (int i = 0; i < iterations; i++) {
+    double start = now_ms();
+    server.Terminate(3000);
+    server.Start();
+    ::Display *dpy = XOpenDisplay(server.GetDisplayString().c_str());
+    total += now_ms() - start;
+
+    ASSERT_TRUE(dpy != NULL);
+    XCloseDisplay(dpy);
+  }
+  report("restart", total);
+
+  server.Terminate(3000);
+  server.RemoveLogFile();
+}
+
+TEST(XServerBenchmark, Regenerate)
+{
+  XServer server;
+  server.SetOption("-logfile", LOGFILE_DIR "/Xorg-benchmark.log");
+  server.SetOption("-config", DUMMY_CONF_PATH);
+  server.SetOption("-noreset", "");
+  server.Start();
+
+  double total = 0;
+  for (int i = 0; i < iterations; i++) {
+    double start = now_ms();
+    ASSERT_TRUE(server.Regenerate());
+    ::Display *dpy = XOpenDisplay(server.GetDisplayString().c_str());
+    total += now_ms() - start;
+
+    ASSERT_TRUE(dpy != NULL);
+    XCloseDisplay(dpy);
+  }
+  report("regenerate", total);
+
+  server.Terminate(3000);
+  server.RemoveLogFile();
+}
+
+/* Request latency as the number of clients grows. All client counts share
+ * one server that accepts up to 2048 clients. */
+class ClientScaling : public MultiClientTest,
+                      public ::testing::WithParamInterface<unsigned int> {
+public:
+  ClientScaling() {
+    SetServerScope(SCOPE_PER_SUITE);
+    SetMaxClients(2048);
+  }
+};
+
+TEST_P(ClientScaling, RequestLatency)
+{
+  unsigned int clients = GetParam();
+
+  AddRequest(REQUEST_SYNC);
+  AddRequest(REQUEST_INTERN_ATOM);
+  AddRequest(REQUEST_CHANGE_PROPERTY);
+  AddRequest(REQUEST_CREATE_WINDOW);
+
+  /* the fixture's own connection counts against -maxclients */
+  unsigned int opened = OpenClients(clients);
+  Run(100);
+
+  LatencyHistogram latency = GetTotalLatency();
+  std::cout << "[ BENCHMARK] " << clients << " clients (" << opened
+            << " connected, " << GetFailedClients() << " lost): "
+            << latency << "\n";
+  std::cout << "[ BENCHMARK] " << clients << " clients connect: "
+            << GetConnectLatency() << "\n";
+
+  std::stringstream s;
+  s << latency.GetPercentile(99);
+  RecordProperty("p99-us", s.str().c_str());
+}
+
+INSTANTIATE_TEST_CASE_P(, ClientScaling,
+                        ::testing::Values(1U, 2U, 4U, 8U, 16U, 32U, 64U, 128U,
+                                          256U, 512U, 1024U, 2047U));
+
+int main(int argc, char *argv[]) {
+  XInitThreads();
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -4,6 +4,7 @@
 #include <sys/wait.h>
 #include <fstream>
 #include <stdexcept>
+#include <vector>
 
 #include <xorg/gtest/xorg-gtest.h>
 #include <gtest/gtest-spi.h>
@@ -76,6 +77,26 @@ TEST(XServer, WaitForSIGUSR1)
   }
 }
 
+TEST(XServer, PrebindSocket)
+{
+  XORG_TESTCASE("With a pre-bound socket, XOpenDisplay() directly after\n"
+                "server.Start() must succeed, the connection is queued\n"
+                "until the server is ready\n");
+  for (int i = 0; i < 20; i++) {
+    XServer server;
+    server.SetOption("-logfile", LOGFILE_DIR "/xorg-testing-xserver-prebind.log");
+    server.SetOption("-config", DUMMY_CONF_PATH);
+    server.SetOption("-noreset", "");
+    server.SetPrebindSocket(true);
+    server.Start();
+    ASSERT_EQ(server.GetState(), Process::RUNNING);
+    Display *dpy = XOpenDisplay(server.GetDisplayString().c_str());
+    ASSERT_TRUE(dpy != NULL);
+    XCloseDisplay(dpy);
+    server.Terminate(500);
+  }
+}
+
 static void assert_masks_equal(Display *dpy)
 {
   int nmasks_before;
@@ -196,8 +217,91 @@ TEST(XServer, WaitForNewDevice)
 
   ASSERT_TRUE(XServer::WaitForDevice(dpy, "PIXART USB OPTICAL MOUSE", 1000));
 }
+
+TEST(XServer, WaitForDevices)
+{
+  XORG_TESTCASE("WaitForDevices() waits for all devices created together");
+
+  XServer server;
+  server.SetOption("-logfile", LOGFILE_DIR "/Xorg-WaitForDevice.log");
+  server.SetOption("-config", DUMMY_CONF_PATH);
+  server.SetOption("-noreset", "");
+  server.Start();
+  ASSERT_EQ(server.GetState(), Process::RUNNING);
+  ::Display *dpy = XOpenDisplay(server.GetDisplayString().c_str());
+  ASSERT_TRUE(dpy != NULL);
+
+  std::vector<xorg::testing::evemu::DeviceDescription> descriptions;
+  descriptions.push_back(xorg::testing::evemu::DeviceDescription::FromFile(TEST_ROOT_DIR "PIXART-USB-OPTICAL-MOUSE.desc"));
+  descriptions.push_back(xorg::testing::evemu::DeviceDescription::FromFile(TEST_ROOT_DIR "SynPS2-Synaptics-TouchPad.desc"));
+  std::vector<xorg::testing::evemu::Device*> devices =
+    xorg::testing::evemu::Device::CreateMany(descriptions);
+
+  std::vector<std::string> names;
+  names.push_back("PIXART USB OPTICAL MOUSE");
+  names.push_back("SynPS/2 Synaptics TouchPad");
+  ASSERT_TRUE(XServer::WaitForDevices(dpy, names, 2000));
+
+  names.push_back("not actually a device");
+  ASSERT_FALSE(XServer::WaitForDevices(dpy, names, 100));
+
+  /* with the time used up, devices are only checked for, not waited for */
+  ASSERT_FALSE(XServer::WaitForDevices(dpy, names, 0));
+  names.pop_back();
+  ASSERT_TRUE(XServer::WaitForDevices(dpy, names, 0));
+
+  for (size_t i = 0; i < devices.size(); i++)
+    delete devices[i];
+}
 #endif
 
+TEST(XServer, Regenerate)
+{
+  XORG_TESTCASE("Regenerate() resets the server, which accepts new\n"
+                "connections once Regenerate() returns");
+
+  XServer server;
+  server.SetOption("-logfile", LOGFILE_DIR "/Xorg-regenerate.log");
+  server.SetOption("-config", DUMMY_CONF_PATH);
+  server.SetOption("-noreset", "");
+  server.Start();
+
+  for (int i = 0; i < 5; i++) {
+    ::Display *dpy = XOpenDisplay(server.GetDisplayString().c_str());
+    ASSERT_TRUE(dpy != NULL);
+    XCloseDisplay(dpy);
+
+    ASSERT_TRUE(server.Regenerate());
+    ASSERT_EQ(server.GetState(), Process::RUNNING);
+  }
+
+  ASSERT_TRUE(server.Terminate());
+  server.RemoveLogFile();
+}
+
+TEST(XServer, KillOtherClients)
+{
+  XORG_TESTCASE("KillOtherClients() kills all clients but the given one");
+
+  XServer server;
+  server.SetOption("-logfile", LOGFILE_DIR "/Xorg-kill-other-clients.log");
+  server.SetOption("-config", DUMMY_CONF_PATH);
+  server.SetOption("-noreset", "");
+  server.Start();
+
+  ::Display *dpy = XOpenDisplay(server.GetDisplayString().c_str());
+  ASSERT_TRUE(dpy != NULL);
+
+  for (int i = 0; i < 3; i++)
+    ASSERT_TRUE(XOpenDisplay(server.GetDisplayString().c_str()) != NULL);
+
+  /* the other connections are dead now, leak them */
+  ASSERT_EQ(XServer::KillOtherClients(dpy), 3U);
+  ASSERT_EQ(XServer::KillOtherClients(dpy), 0U);
+
+  XCloseDisplay(dpy);
+}
+
 TEST(XServer, IOErrorException)
 {
   ASSERT_THROW({
@@ -358,6 +462,61 @@ TEST(XServer, KeepAlive)
   ASSERT_EQ(errno, ESRCH);
 }
 
+TEST(XServer, Isolation)
+{
+  XORG_TESTCASE("An isolated server runs on display :0 with a private /tmp\n"
+                "that is not visible outside the test process");
+
+  std::string marker = "/tmp/xorg-gtest-isolation-marker";
+  unlink(marker.c_str());
+
+  /* Isolation applies to the whole process, so do it in a child */
+  pid_t pid = fork();
+  if (pid == 0) {
+    /* only missing namespace support skips the test, a failing isolated
+       server must fail it */
+    try {
+      XServer::Isolate(XServer::ISOLATION_NETWORK);
+    } catch (const std::runtime_error &e) {
+      std::cerr << e.what() << "\n";
+      exit(2);
+    }
+
+    XServer server;
+    server.SetIsolation(XServer::ISOLATION_NETWORK);
+    server.SetDisplayNumber(0);
+    server.SetOption("-logfile", LOGFILE_DIR "/Xorg-isolation.log");
+    server.SetOption("-config", DUMMY_CONF_PATH);
+    try {
+      server.Start();
+    } catch (const std::runtime_error &e) {
+      std::cerr << e.what() << "\n";
+      exit(3);
+    }
+
+    std::ofstream(marker.c_str()) << "isolated";
+
+    Display *dpy = XOpenDisplay(":0");
+    if (!dpy)
+      exit(1);
+    XCloseDisplay(dpy);
+    server.Terminate();
+    exit(0);
+  }
+
+  int status;
+  ASSERT_EQ(waitpid(pid, &status, 0), pid);
+  ASSERT_TRUE(WIFEXITED(status));
+  if (WEXITSTATUS(status) == 2) {
+    std::cerr << "Namespaces not available, skipping\n";
+    return;
+  }
+  ASSERT_NE(WEXITSTATUS(status), 3) << "Isolated server failed to start";
+  ASSERT_EQ(WEXITSTATUS(status), 0);
+
+  ASSERT_NE(access(marker.c_str(), F_OK), 0);
+}
+
 TEST(XServer, RemoveOption)
 {
   int i = 0;